@@ -1,24 +1,26 @@
 #include "encryption.hpp"
 #include "alu.hpp"
 #include "matrix.hpp"
+#include "tensor.hpp"
+#include "lut.hpp"
+#include "leveled.hpp"
+#include "params.hpp"
+#include "reference.hpp"
+#include "shiftmodel.hpp"
+#include "session.hpp"
+#include "worker.hpp"
 #include <iostream>
+#include <vector>
+#include <cstdlib>
 #include <sys/time.h>
+#include <unistd.h>
 
 
-int ShiftDotProduct(int* inputs, int * We,const int cols){
-	int result=0;
-	for(int i=0; i<cols; i++){
-		if(We[i]<0){
-			for( int j=0; j<-We[i]; j++){
-				inputs[i]=inputs[i]>>1;
-			}
-		}
-		else if(We[i]>0){
-			for( int j=0; j<We[i]; j++){
-				inputs[i]=inputs[i]<<1;
-			}} 
-		result=result+inputs[i];
-	}
+/* Plaintext shiftDot with the semantics of the encrypted one at bits bits, inputs are left untouched */
+int ShiftDotProduct(const int* inputs, const int* We, const int cols, const int bits){
+	std::vector<int32_t> row(inputs, inputs + cols);
+	int32_t result;
+	ref_shiftDot(&result, row.data(), 1, cols, We, bits);
 	return result;
 }
 
@@ -76,20 +78,32 @@ void ReLU(LweSample* result, const LweSample* a,const int bits,const TFheGateBoo
 }
 
 
-int verify(int A, int B){
-    if (A==B){printf("Verify Sucess!");}
-    else{printf("There is difference between plaintext result and decrypted result!");}
+/* Compares a decrypted value with its plaintext reference at bits bits. Returns 0 if they match, -1 otherwise */
+int verify(int A, int B, const int bits){
+    if (ref_wrap(A, bits)==ref_wrap(B, bits)){printf("Verify Success!\n"); return 0;}
+    printf("There is difference between plaintext result and decrypted result!\n");
+    return -1;
 }
 
-int main(){
+/* Usage: SHE [parameter profile, default 80] [workers, default 0: section 9 evaluates its row sums on that many worker processes] */
+int main(int argc, char** argv){
         const double clocks2seconds = 1. / CLOCKS_PER_SEC;
 	// setup parameters
 	typedef int8_t num_type ;
 	size_t bits = sizeof(num_type) * 4;
-	const int minimum_lambda = 80;
-	TFheGateBootstrappingParameterSet* params = new_default_gate_bootstrapping_parameters(minimum_lambda);
+	ParameterProfile profile;
+	if(findProfile(argc > 1 ? argv[1] : "80", profile) < 0) return 1;
+	printf("Parameter profile %s\n", profile.name.c_str());
+	TFheGateBootstrappingParameterSet* params = newParameters(profile);
 	const TFheGateBootstrappingSecretKeySet* sk = new_random_gate_bootstrapping_secret_keyset(params);
 	const TFheGateBootstrappingCloudKeySet* ck = &sk->cloud;
+	int failures = 0;  // checks that did not match their plaintext reference
+	// forked before the first OpenMP region, see WorkerPool
+	WorkerPool *pool = NULL;
+	if(argc > 2 && atoi(argv[2]) > 0){
+		pool = new WorkerPool(atoi(argv[2]), ck, "/tmp/SHE." + std::to_string(getpid()) + ".sock");
+		printf("%d workers\n", pool->size());
+	}
 	
         printf("######## 1. shiftDot(A[0:input_size-1], Be[0:input_size-1]) Verification#######\n");
         //Unencrypted DotProduct between inputs A[input_size] and B[input_size]
@@ -109,7 +123,7 @@ int main(){
 	        printf(" %d", Be[i]);
 	}
         printf("]\n");
-	result=ShiftDotProduct(A,Be,input_size);
+	result=ShiftDotProduct(A,Be,input_size,bits);
 
 	//Encrypted DotProduct between Enc_A[input_size][bits] and B[input_size]
 	LweSample **Enc_A=new LweSample*[input_size];
@@ -120,45 +134,234 @@ int main(){
         Enc_result = new_gate_bootstrapping_ciphertext_array(bits, ck->params);
 
 	for(num_type i=0; i<input_size;i++){
-	encrypt<num_type>(Enc_A[i], i, sk);
+	encrypt_bits(Enc_A[i], i, bits, sk);
 	}
         //num_type plain_hidden_result=decrypt<num_type>(enc_inputs[3], sk);
         shiftDot(Enc_result, Enc_A, Be, input_size, ck, bits);
-        num_type plain_result=decrypt<num_type>(Enc_result, sk);
+        int plain_result=decrypt_bits(Enc_result, bits, sk);
 
         
         
         printf("Decrypted Result:%d\n",plain_result);
         //cout<<"Decrypted Result"<<plain_hidden_result;
 	printf("Plaintext Result: %d\n",result);
+        failures+=verify(plain_result, result, bits)<0;
 
 
         
         int A1=0, B1=-4;
         printf("######## 2. Max(A=%d, B=%d) Verification ####### \n", A1, B1);
         LweSample * Max_Enc_A=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
-        encrypt<num_type>(Max_Enc_A, A1, sk);
+        encrypt_bits(Max_Enc_A, A1, bits, sk);
         LweSample * Max_Enc_B=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
-        encrypt<num_type>(Max_Enc_B, B1, sk);
+        encrypt_bits(Max_Enc_B, B1, bits, sk);
         LweSample * Max_Enc_Result=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
         maximum(Max_Enc_Result, Max_Enc_A, Max_Enc_B, bits, ck);
-        num_type Max_plain_result=decrypt<num_type>(Max_Enc_Result, sk);
+        int Max_plain_result=decrypt_bits(Max_Enc_Result, bits, sk);
         printf("Decrypted Result: %d\n",Max_plain_result);
         printf("Plaintex Result: %d\n",max(A1,B1));
+        failures+=verify(Max_plain_result, max(A1,B1), bits)<0;
         
 
 
 	int A2=-5;
         printf("######## 3. ReLU(A=%d) Verification######## \n", A2);
         LweSample * ReLU_Enc_A=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
-        encrypt<num_type>(ReLU_Enc_A, A2, sk);
+        encrypt_bits(ReLU_Enc_A, A2, bits, sk);
         LweSample * ReLU_Enc_Result=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
         ReLU(ReLU_Enc_Result, ReLU_Enc_A,bits,ck);
-        num_type ReLU_plain_result=decrypt<num_type>(ReLU_Enc_Result, sk);
+        int ReLU_plain_result=decrypt_bits(ReLU_Enc_Result, bits, sk);
         printf("Decrypted Result: %d\n",ReLU_plain_result);
         printf("Plaintex Result: %d\n",max(A2,0));
-        //verify(ReLU_plain_result, max(A,0));
+        failures+=verify(ReLU_plain_result, max(A2,0), bits)<0;
+
+        printf("######## 4. LUT ReLU(A=%d), bits to digit and back, Verification######## \n", A2);
+        LweSample * LUT_ReLU_Enc_Result=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
+        failures+=lutReLU(&LUT_ReLU_Enc_Result, &ReLU_Enc_A, 1, bits, ck)<0;
+        int LUT_ReLU_plain_result=decrypt_bits(LUT_ReLU_Enc_Result, bits, sk);
+        printf("Decrypted Result: %d\n",LUT_ReLU_plain_result);
+        printf("Plaintex Result: %d\n",max(A2,0));
+        failures+=verify(LUT_ReLU_plain_result, max(A2,0), bits)<0;
+
+        printf("######## 5. Argmax(A[0:input_size-1]) Verification######## \n");
+        // scores 0..input_size-1 are in Enc_A, the largest is the last one
+        const int index_bits = 3;
+        LweSample * Argmax_Enc_Index=new_gate_bootstrapping_ciphertext_array(index_bits, ck->params);
+        argmax(Argmax_Enc_Index, NULL, Enc_A, input_size, ck, bits, index_bits);
+        int Argmax_plain_result=0;
+        for(int i=0; i<index_bits; i++){
+                Argmax_plain_result |= bootsSymDecrypt(&Argmax_Enc_Index[i], sk) << i;
+        }
+        printf("Decrypted Result: %d\n",Argmax_plain_result);
+        printf("Plaintex Result: %d\n",input_size-1);
+        failures+=verify(Argmax_plain_result, input_size-1, index_bits+1)<0;
+
+        printf("######## 6. Bulk gate ReLU(A[0:input_size-1] - 4) Verification######## \n");
+        std::vector<int32_t> Bulk_A(input_size), Bulk_expected(input_size), Bulk_decrypted(input_size);
+        LweSample **Bulk_Enc_Result=new LweSample*[input_size];
+        for(int i=0; i<input_size; i++){
+                Bulk_A[i]=i-4;
+                encrypt_bits(Enc_A[i], Bulk_A[i], bits, sk);
+                Bulk_Enc_Result[i]=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
+        }
+        CipherTensor Bulk_In(1, input_size, bits, params), Bulk_Out(1, input_size, bits, params);
+        LweSample **Bulk_rows[1]={Enc_A}, **Bulk_result_rows[1]={Bulk_Enc_Result};
+        Bulk_In.load(Bulk_rows);
+        relu(Bulk_Out, Bulk_In, ck);
+        Bulk_Out.store(Bulk_result_rows);
+        decrypt_tensor(Bulk_decrypted.data(), Bulk_Enc_Result, input_size, bits, sk);
+        ref_relu(Bulk_expected.data(), Bulk_A.data(), input_size, bits);
+        failures+=verify_tensor("ReLU", Bulk_expected.data(), Bulk_decrypted.data(), input_size, bits).mismatches>0;
+
+        printf("######## 7. Bit-plane tensor ReLU(A + A) Verification######## \n");
+        CipherTensor Tensor_A(1, input_size, bits, params), Tensor_Planes(1, input_size, bits, params, BIT_PLANE_MAJOR);
+        std::vector<int32_t> Tensor_doubled(input_size);
+        for(int i=0; i<input_size; i++){
+                encrypt_bits(Tensor_A.element(i), Bulk_A[i], bits, sk);
+                Tensor_doubled[i]=ref_wrap(2*Bulk_A[i], bits);
+        }
+        Tensor_Planes.copyFrom(Tensor_A);
+        mat_add(Tensor_Planes, Tensor_Planes, Tensor_Planes, ck);
+        relu(Tensor_Planes, Tensor_Planes, ck);
+        Tensor_A.copyFrom(Tensor_Planes);
+        for(int i=0; i<input_size; i++){
+                Bulk_decrypted[i]=decrypt_bits(Tensor_A.element(i), bits, sk);
+        }
+        ref_relu(Bulk_expected.data(), Tensor_doubled.data(), input_size, bits);
+        failures+=verify_tensor("Tensor ReLU", Bulk_expected.data(), Bulk_decrypted.data(), input_size, bits).mismatches>0;
+
+        printf("######## 8. Leveled CMux ReLU(A=%d), Max(A=%d, B=%d), LUT on key-owner selectors Verification######## \n", A2, A1, B1);
+        // selectors are encrypted by the key owner: the sign of A2, A1 < B1 and the LUT index
+        const int lut_index = 5;
+        std::vector<int32_t> Square_table(1 << index_bits);
+        for(int m=0; m<(1 << index_bits); m++){
+                Square_table[m]=ref_wrap(m*m, bits);
+        }
+        TGswSampleFFT *Selectors=new_selector_array(2 + index_bits, ck);
+        encryptSelector(&Selectors[0], A2 < 0, sk);
+        encryptSelector(&Selectors[1], A1 < B1, sk);
+        for(int j=0; j<index_bits; j++){
+                encryptSelector(&Selectors[2 + j], (lut_index >> j) & 1, sk);
+        }
+        LeveledValue *Leveled=new_LeveledValue_array(3, bits, ck);
+        LeveledValue *Leveled_B=new_LeveledValue_array(1, bits, ck);
+        encryptLeveled(&Leveled[0], A2, sk);
+        encryptLeveled(&Leveled[1], A1, sk);
+        encryptLeveled(&Leveled_B[0], B1, sk);
+        leveledReLU(&Leveled[0], &Selectors[0], &Leveled[0], 1, ck);
+        leveledMax(&Leveled[1], &Selectors[1], &Leveled[1], &Leveled_B[0], 1, ck);
+        leveledLUT(&Leveled[2], &Selectors[2], index_bits, Square_table.data(), bits, ck);
+        LweSample *Leveled_Enc_Result[3];
+        for(int i=0; i<3; i++){
+                Leveled_Enc_Result[i]=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
+        }
+        int refreshed=leveledExtract(Leveled_Enc_Result, Leveled, 3, ck);
+        printf("Bootstrapped on extraction: %d of 3\n", refreshed);
+        failures+=verify(decrypt_bits(Leveled_Enc_Result[0], bits, sk), max(A2,0), bits)<0;
+        failures+=verify(decrypt_bits(Leveled_Enc_Result[1], bits, sk), max(A1,B1), bits)<0;
+        failures+=verify(decrypt_bits(Leveled_Enc_Result[2], bits, sk), Square_table[lut_index], bits)<0;
+
+        printf("######## 9. Shift model file round trip, shiftNetwork(A[0:2]) Verification######## \n");
+        // 3 -> 2 (ReLU) -> 1, weights of up to two powers of two, at the width of the inputs
+        ShiftModel Shift_model;
+        Shift_model.frac_bits=0;
+        ShiftLayer Shift_hidden={2, 3, 2, (int) bits, true, {1,0, -1,1, 1,-1, -1,0, 1,-1, 0,0}, {0,0, 1,0, 0,0, 0,0, 1,0, 0,0}, {1, -2}};
+        ShiftLayer Shift_out={1, 2, 1, (int) bits, false, {1, -1}, {1, 0}, {0}};
+        Shift_model.layers.push_back(Shift_hidden);
+        Shift_model.layers.push_back(Shift_out);
+        ShiftModel Shift_read;
+        char Shift_path[]="/tmp/SHE_shift_model.XXXXXX";
+        const int Shift_fd=mkstemp(Shift_path);
+        if(Shift_fd<0) return 1;
+        close(Shift_fd);
+        const bool Shift_loaded=writeShiftModel(Shift_model, Shift_path)>=0 && readShiftModel(Shift_read, Shift_path)>=0;
+        unlink(Shift_path);
+        if(!Shift_loaded) return 1;
+        bool Shift_same=Shift_read.frac_bits==Shift_model.frac_bits && Shift_read.layers.size()==Shift_model.layers.size();
+        for(size_t l=0; Shift_same && l<Shift_model.layers.size(); l++){
+                const ShiftLayer &w=Shift_model.layers[l], &r=Shift_read.layers[l];
+                Shift_same=w.rows==r.rows && w.cols==r.cols && w.terms==r.terms && w.bits==r.bits && w.relu==r.relu
+                           && w.signs==r.signs && w.exps==r.exps && w.bias==r.bias;
+        }
+        printf("Model file round trip: %s\n", Shift_same ? "same" : "DIFFERENT");
+        failures+=!Shift_same;
+        std::vector<int32_t> Shift_h(Bulk_A.begin(), Bulk_A.begin() + 3);
+        for(const ShiftLayer& layer: Shift_read.layers){
+                std::vector<int32_t> next(layer.rows);
+                ref_shiftLayer(next.data(), Shift_h.data(), layer.rows, layer.cols, layer.terms, layer.signs.data(), layer.exps.data(), layer.bias.data(), layer.bits, layer.relu);
+                Shift_h=next;
+        }
+        for(int i=0; i<3; i++){
+                encrypt_bits(Enc_A[i], Bulk_A[i], bits, sk);
+        }
+        LweSample *Shift_Enc_Result=new_gate_bootstrapping_ciphertext_array(bits, ck->params);
+        shiftNetwork(&Shift_Enc_Result, Enc_A, Shift_read, ck, pool);
+        int Shift_decrypted=decrypt_bits(Shift_Enc_Result, bits, sk);
+        failures+=verify_tensor("Shift network", Shift_h.data(), &Shift_decrypted, 1, bits).mismatches>0;
+        if(pool!=NULL){
+                pool->reduce_add(Shift_Enc_Result, Enc_A, 3, bits);
+                failures+=verify(decrypt_bits(Shift_Enc_Result, bits, sk), Bulk_A[0]+Bulk_A[1]+Bulk_A[2], bits)<0;
+        }
+
+        printf("######## 10. Tensor A + B, element-major and bit-plane-major Verification######## \n");
+        CipherTensor Add_A(1, input_size, bits, params), Add_B(1, input_size, bits, params), Add_Sum(1, input_size, bits, params);
+        CipherTensor Add_A_planes(1, input_size, bits, params, BIT_PLANE_MAJOR), Add_B_planes(1, input_size, bits, params, BIT_PLANE_MAJOR),
+                     Add_Sum_planes(1, input_size, bits, params, BIT_PLANE_MAJOR);
+        std::vector<int32_t> Add_expected(input_size), Add_elements(input_size), Add_planes(input_size);
+        for(int i=0; i<input_size; i++){
+                encrypt_bits(Add_A.element(i), Bulk_A[i], bits, sk);
+                encrypt_bits(Add_B.element(i), 3*i-7, bits, sk);
+                Add_expected[i]=ref_wrap(Bulk_A[i] + 3*i-7, bits);
+        }
+        Add_A_planes.copyFrom(Add_A);
+        Add_B_planes.copyFrom(Add_B);
+        mat_add(Add_Sum, Add_A, Add_B, ck);
+        mat_add(Add_Sum_planes, Add_A_planes, Add_B_planes, ck);
+        Tensor_A.copyFrom(Add_Sum_planes);
+        for(int i=0; i<input_size; i++){
+                Add_elements[i]=decrypt_bits(Add_Sum.element(i), bits, sk);
+                Add_planes[i]=decrypt_bits(Tensor_A.element(i), bits, sk);
+        }
+        failures+=verify_tensor("Element-major add", Add_expected.data(), Add_elements.data(), input_size, bits).mismatches>0;
+        failures+=verify_tensor("Bit-plane-major add", Add_elements.data(), Add_planes.data(), input_size, bits).mismatches>0;
+
+        printf("######## 11. ScoringSession, rescore(X, deltas) against score(X + deltas) Verification######## \n");
+        const size_t Session_bits=8;
+        const int Session_dim=4, Session_changed=2;
+        ApproxLogRegression Session_model(std::vector<double>{1, -2, 3, 1}, std::vector<double>{0.5, 0.25}, Session_dim, ck, Session_bits, 4);
+        ScoringSession Session(&Session_model, ck);
+        int Session_X[Session_dim]={3, -1, 2, 5}, Session_features[Session_changed]={1, 3}, Session_deltas[Session_changed]={-2, 4};
+        LweSample **Session_Enc_X=new LweSample*[Session_dim];
+        LweSample **Session_Enc_deltas=new LweSample*[Session_changed];
+        for(int i=0; i<Session_dim; i++){
+                Session_Enc_X[i]=new_gate_bootstrapping_ciphertext_array(Session_bits, ck->params);
+                encrypt_bits(Session_Enc_X[i], Session_X[i], Session_bits, sk);
+        }
+        for(int k=0; k<Session_changed; k++){
+                Session_Enc_deltas[k]=new_gate_bootstrapping_ciphertext_array(Session_bits, ck->params);
+                encrypt_bits(Session_Enc_deltas[k], Session_deltas[k], Session_bits, sk);
+        }
+        LweSample *Session_rescored=new_gate_bootstrapping_ciphertext_array(Session_bits, ck->params);
+        LweSample *Session_scored=new_gate_bootstrapping_ciphertext_array(Session_bits, ck->params);
+        Session.score(Session_rescored, 1, Session_Enc_X);
+        Session.rescore(Session_rescored, 1, Session_features, Session_Enc_deltas, Session_changed);
+        // the updated sample, scored from scratch under another id
+        for(int k=0; k<Session_changed; k++){
+                Session_X[Session_features[k]]+=Session_deltas[k];
+                encrypt_bits(Session_Enc_X[Session_features[k]], Session_X[Session_features[k]], Session_bits, sk);
+        }
+        Session.score(Session_scored, 2, Session_Enc_X);
+        failures+=verify(decrypt_bits(Session_rescored, Session_bits, sk), decrypt_bits(Session_scored, Session_bits, sk), Session_bits)<0;
+        for(int i=0; i<Session_dim; i++) delete_gate_bootstrapping_ciphertext_array(Session_bits, Session_Enc_X[i]);
+        for(int k=0; k<Session_changed; k++) delete_gate_bootstrapping_ciphertext_array(Session_bits, Session_Enc_deltas[k]);
+        delete[] Session_Enc_X;
+        delete[] Session_Enc_deltas;
+        delete_gate_bootstrapping_ciphertext_array(Session_bits, Session_rescored);
+        delete_gate_bootstrapping_ciphertext_array(Session_bits, Session_scored);
+        delete pool;
 
+        printf("%d failed checks\n", failures);
+        return failures > 0 ? 1 : 0;
 }
 
 
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <vector>
 #include "alu.hpp"
+#include "bootstrap.hpp"
 /*
 Implements bitwise full-adder circuit on two n-bit integers
 Parallel implementation gives ~0.65x speedup, which close to theoretical circuit speedup of 0.6
@@ -115,46 +118,46 @@ void full_adder(LweSample *sum, const LweSample *x, const LweSample *y, const in
     delete_LweSample_array(2, carry);
 }
 
-void add(LweSample* sum, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  LweSample *carry = new_gate_bootstrapping_ciphertext(ck->params),
-            *tmp_s = new_gate_bootstrapping_ciphertext(ck->params),
-            *tmp_c = new_gate_bootstrapping_ciphertext(ck->params);
-
-
-
-  // first iteration
-//#pragma omp parallel sections num_threads(4)
-
-
-
-  bootsXOR(&sum[0], &a[0], &b[0], ck);
-  bootsAND(carry, &a[0], &b[0], ck);
+/**
+Ripple-carry adder core: sum = a + b + cin, carry_out = carry out of the MSB. The circuit is circuit::adder,
+evaluated with batched bootstraps
+*/
+static void adder_core(LweSample* sum, LweSample* carry_out, const LweSample* a, const LweSample* b, const LweSample* carry_in, const int cin_const,
+                       const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  TfheBackend be(ck);
+  circuit::adder(be, sum, carry_out, a, b, carry_in, cin_const, size);
+}
 
+void add(LweSample* sum, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  adder_core(sum, NULL, a, b, NULL, 0, ck, size);
+}
 
-  for(int i = 1; i < size; i++) {
+/**
+sum = a + b + carry_in, with the carry out of the MSB in carry_out. Chains multi-word additions.
+carry_in == NULL means a carry in of 0, carry_out == NULL drops the carry out
+*/
+void add_with_carry(LweSample* sum, LweSample* carry_out, const LweSample* a, const LweSample* b, const LweSample* carry_in, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  adder_core(sum, carry_out, a, b, carry_in, 0, ck, size);
+}
 
-    #pragma omp parallel sections num_threads(2)
-    {
-      #pragma omp section
-      bootsXOR(tmp_s, &a[i], &b[i], ck);
-      #pragma omp section
-      bootsAND(tmp_c, &a[i], &b[i], ck);
-    }
-    #pragma omp parallel sections num_threads(2)
-    {
-      #pragma omp section
-      bootsXOR(&sum[i], tmp_s, carry, ck);
-      #pragma omp section
-      bootsAND(carry, carry, tmp_s, ck);
-    }
-    bootsOR(carry, carry, tmp_c, ck);
-  }
+/**
+Wavefront forms of add and sub (circuit::adder_batch): instead of count ripple chains of 2-gate batches, every bit
+position of all count chains is one batch, so the batched bootstrap has count times more samples to share each row
+of the bootstrapping key with
+*/
+void add_batch(LweSample** sums, const LweSample* const* as, const LweSample* const* bs, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  TfheBackend be(ck);
+  circuit::add_batch(be, sums, as, bs, count, size);
+}
 
-  // clean up
-  delete_gate_bootstrapping_ciphertext(carry);
-  delete_gate_bootstrapping_ciphertext(tmp_s);
-  delete_gate_bootstrapping_ciphertext(tmp_c);
+void sub_batch(LweSample** results, const LweSample* const* as, const LweSample* const* bs, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  TfheBackend be(ck);
+  circuit::sub_batch(be, results, as, bs, count, size);
+}
 
+void reduce_add_batch(LweSample** results, LweSample** const* arrays, const int* num_arrays, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  TfheBackend be(ck);
+  circuit::reduce_add_batch(be, results, arrays, num_arrays, count, size);
 }
 
 
@@ -411,16 +414,66 @@ void rightRotate(LweSample* result, const LweSample* a, const TFheGateBootstrapp
 
 
 
-/**/
+/** a - b = a + NOT(b) + 1: a single adder with a constant carry in. NOT is free */
 void sub(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
   LweSample *c = new_gate_bootstrapping_ciphertext_array(size, ck->params);
-  twosComplement(c, b, ck, size);
-  add(result, a, c, ck, size);
+  NOT(c, b, ck, size);
+  adder_core(result, NULL, a, c, NULL, 1, ck, size);
+
+  // clean up
+  delete_gate_bootstrapping_ciphertext_array(size, c);
+}
+
+/**
+result = a - b - borrow_in, with the borrow out of the MSB in borrow_out. Chains multi-word subtractions.
+The carry of a + NOT(b) + NOT(borrow_in) is the complement of the borrow.
+borrow_in == NULL means a borrow in of 0, borrow_out == NULL drops the borrow out
+*/
+void sub_with_borrow(LweSample* result, LweSample* borrow_out, const LweSample* a, const LweSample* b, const LweSample* borrow_in, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  LweSample *c = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  NOT(c, b, ck, size);
+  if(borrow_in != NULL) {
+    LweSample *carry_in = new_gate_bootstrapping_ciphertext(ck->params);
+    bootsNOT(carry_in, borrow_in, ck);
+    adder_core(result, borrow_out, a, c, carry_in, 0, ck, size);
+    delete_gate_bootstrapping_ciphertext(carry_in);
+  }
+  else {
+    adder_core(result, borrow_out, a, c, NULL, 1, ck, size);
+  }
+  if(borrow_out != NULL)
+    bootsNOT(borrow_out, borrow_out, ck);
 
   // clean up
   delete_gate_bootstrapping_ciphertext_array(size, c);
 }
 
+/**
+result = (a < b), the borrow out of a - b. Only the carry chain is evaluated, none of the difference bits.
+For signed inputs the MSBs are flipped first (free), which maps two's complement order onto unsigned order.
+*/
+void lessThan(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, bool is_signed) {
+  TfheBackend be(ck);
+  circuit::lessThan(be, result, a, b, size, is_signed);
+}
+
+/**
+Encrypted argmax: log-depth tournament of comparators, carrying the index bits along through MUX (circuit::argmax).
+The comparisons of a round run as one batch, so are all the selections
+*/
+void argmax(LweSample* index, LweSample* value, LweSample** scores, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int index_bits, bool is_signed) {
+  TfheBackend be(ck);
+  circuit::argmax(be, index, value, scores, count, size, index_bits, is_signed);
+}
+
+/**
+Encrypted top-k with a bitonic partial sorting network (circuit::topk), one batch per stage
+*/
+void topk(LweSample** indices, LweSample** values, LweSample** scores, const int count, const int k, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int index_bits, bool is_signed) {
+  TfheBackend be(ck);
+  circuit::topk(be, indices, values, scores, count, k, size, index_bits, is_signed);
+}
+
 /**
 Implements simple shift and add algorithm:
 Let A and B be the operands, s.t P = AxB
@@ -433,28 +486,52 @@ Space complexity is O(n^2)
 
 */
 void mult(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  mult_batch(&result, &a, &b, 1, ck, size);
+}
+
+/**
+count independent products result[k] = a[k] * b[k] (same algorithm as mult).
+The partial product bits of all count products are bootstrapped as a single batch, then the products are reduce
+summed together (reduce_add_batch)
+*/
+void mult_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
   // to store the intermediate results of final result. Note intermediate result has 2n bits
   // p = p_0 * 2^0 + .. + p_{n-1} * 2^{n-1}
-  // Create n n-bit arrays
-  LweSample **p = new LweSample*[size];
-  for(int i = 0; i < size; i++) {
-    p[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
-    zero(p[i], ck, size);
+  // Create n n-bit arrays per product
+  LweSample **p = new LweSample*[count*size];
+  for(size_t q = 0; q < count*size; q++) {
+    p[q] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
   }
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    for(int j = 0; j < size-i; j++) {
-      bootsAND(&p[i][i+j], &a[j], &b[i], ck);
-    }
+  // all partial product bits are independent: bootstrap them as a single batch
+  TfheBackend be(ck);
+  circuit::partial_products(be, p, a, b, count, size);
+  std::vector<LweSample**> groups(count);
+  std::vector<int> nums(count, size);
+  for(int k = 0; k < count; k++) {
+    groups[k] = &p[k*size];
   }
-  reduce_add(result, p, size, ck, size);
+  reduce_add_batch(result, groups.data(), nums.data(), count, ck, size);
 
   // clean up
-  for(int i = 0; i < size; i++)
-    delete_gate_bootstrapping_ciphertext_array(size, p[i]);
+  for(size_t q = 0; q < count*size; q++)
+    delete_gate_bootstrapping_ciphertext_array(size, p[q]);
   delete[] p;
 }
 
+/**
+Fixed-point multiply for values with frac_bits fraction bits: result = round(a * b / 2^frac_bits), modulo 2^size.
+Only the partial products in the window of columns feeding the result are bootstrapped (circuit::fixed_partial_products),
+the dropped low columns are replaced by a correction constant, and the kept top size bits are the rescaled product.
+*/
+void mult_fixed(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int frac_bits) {
+  mult_fixed_batch(&result, &a, &b, 1, ck, size, frac_bits);
+}
+
+void mult_fixed_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int frac_bits) {
+  TfheBackend be(ck);
+  circuit::mult_fixed_batch(be, result, a, b, count, size, frac_bits);
+}
+
 // NOTE assumes n >= 0
 void power(LweSample* result, const LweSample* a, int n, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
   if(n == 0) {
@@ -470,19 +547,10 @@ void power(LweSample* result, const LweSample* a, int n, const TFheGateBootstrap
   }
 }
 
-/* Implements two's complement*/
+/* Implements two's complement: NOT(a) + 1 as an incrementer, no second operand */
 void twosComplement(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  LweSample *one = new_gate_bootstrapping_ciphertext_array(size, ck->params),
-            *c = new_gate_bootstrapping_ciphertext_array(size, ck->params);;
-  zero(one, ck, size);
-  bootsCONSTANT(&one[0], 1, ck);
-
-  NOT(c, a, ck, size);
-  add(result, c, one, ck, size);
-
-  // clean up
-  delete_gate_bootstrapping_ciphertext_array(size, one);
-  delete_gate_bootstrapping_ciphertext_array(size, c);
+  TfheBackend be(ck);
+  circuit::twosComplement(be, result, a, size);
 }
 
 void NOT(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
@@ -515,75 +583,42 @@ void zero(LweSample* result, const TFheGateBootstrappingCloudKeySet* ck, const s
 }
 
 void OR(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsOR(&result[i], &a[i], &b[i], ck);
-  }
+  bootsOR_batch(result, a, b, size, ck);
 }
 
 void AND(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsAND(&result[i], &a[i], &b[i], ck);
-  }
+  bootsAND_batch(result, a, b, size, ck);
 }
 
 void NAND(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsNAND(&result[i], &a[i], &b[i], ck);
-  }
+  bootsNAND_batch(result, a, b, size, ck);
 }
 
 void NOR(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsNOR(&result[i], &a[i], &b[i], ck);
-  }
+  bootsNOR_batch(result, a, b, size, ck);
 }
 
 void XOR(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsXOR(&result[i], &a[i], &b[i], ck);
-  }
+  bootsXOR_batch(result, a, b, size, ck);
 }
 
 void XNOR(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsXNOR(&result[i], &a[i], &b[i], ck);
-  }
+  bootsXNOR_batch(result, a, b, size, ck);
 }
 void ANDNY(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsANDNY(&result[i], &a[i], &b[i], ck);
-  }
+  bootsANDNY_batch(result, a, b, size, ck);
 }
 void ANDYN(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsANDYN(&result[i], &a[i], &b[i], ck);
-  }
+  bootsANDYN_batch(result, a, b, size, ck);
 }
 void ORNY(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsORNY(&result[i], &a[i], &b[i], ck);
-  }
+  bootsORNY_batch(result, a, b, size, ck);
 }
 void ORYN(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsORYN(&result[i], &a[i], &b[i], ck);
-  }
+  bootsORYN_batch(result, a, b, size, ck);
 }
 void MUX(LweSample* result, const LweSample* a, const LweSample* b, const LweSample* c, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  #pragma omp parallel for num_threads(NUM_THREADS)
-  for(int i = 0; i < size; i++) {
-    bootsMUX(&result[i], &a[i], &b[i], &c[i], ck);
-  }
+  bootsMUX_batch(result, a, b, c, size, ck);
 }
 
 void CONSTANT(LweSample* result, const int& a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
@@ -14,12 +14,26 @@
 //void bootsCOPYPointer(LweSample *result, LweSample *ca);
 
 void add(LweSample* sum, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void add_with_carry(LweSample* sum, LweSample* carry_out, const LweSample* a, const LweSample* b, const LweSample* carry_in, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+// count independent additions / subtractions advanced bit by bit together: one batch per gate level for all of them
+void add_batch(LweSample** sums, const LweSample* const* as, const LweSample* const* bs, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void sub_batch(LweSample** results, const LweSample* const* as, const LweSample* const* bs, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void leftRotate(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, int amnt);
 void leftShift(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, int amnt);
 void rightRotate(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, int amnt);
 void rightShift(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, int amnt);
 void sub(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void sub_with_borrow(LweSample* result, LweSample* borrow_out, const LweSample* a, const LweSample* b, const LweSample* borrow_in, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void lessThan(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, bool is_signed=true);
+// index (index_bits bits, unsigned) and value of the largest of count scores; value may be NULL
+void argmax(LweSample* index, LweSample* value, LweSample** scores, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int index_bits, bool is_signed=true);
+// indices and values of the k largest scores, in decreasing order; values may be NULL
+void topk(LweSample** indices, LweSample** values, LweSample** scores, const int count, const int k, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int index_bits, bool is_signed=true);
 void mult(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void mult_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+// Fixed-point product a * b / 2^frac_bits, rounded, at the scale of the inputs (truncated multiplier)
+void mult_fixed(LweSample* result, const LweSample* a, const LweSample* b, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int frac_bits);
+void mult_fixed_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size, const int frac_bits);
 void power(LweSample* result, const LweSample* a, int n, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void twosComplement(LweSample* result, const LweSample* a, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 //void copyPointer(LweSample* dest,  LweSample* source, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
@@ -47,6 +61,8 @@ void CONSTANT(LweSample* result, const int& a, const TFheGateBootstrappingCloudK
 void reduce_add(LweSample* result, LweSample** arrays, int num_arrays, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void reduce_add_4(LweSample* result, LweSample** arrays, int num_arrays, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void reduce_add_8(LweSample* result, LweSample** arrays, int num_arrays, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+// results[k] = sum of the num_arrays[k] arrays of arrays[k] (0 if none), every tree level of all groups as one add_batch
+void reduce_add_batch(LweSample** results, LweSample** const* arrays, const int* num_arrays, const int count, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 
 void seq_add(LweSample* result, LweSample** arrays, int num_arrays, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 
@@ -0,0 +1,161 @@
+/*
+Offline batch inference with per-layer checkpoints.
+Usage: SHE_batch <cloud key> <weights csv> <coefs csv> <dim> <bits> <scale factor> <inputs> <outputs> [--checkpoint <dir>] [--resume] [--numa]
+                 [--workers <n>] [--worker-socket <path>]
+inputs holds one SERVER_PREDICT message per sample (see server.hpp), full or seeded (SHE_encrypt --seeded), outputs
+receives one SERVER_RESULT message per sample.
+--numa pins the threads round robin to the NUMA nodes and gives each node a copy of the cloud key (numa.hpp).
+--workers evaluates the preactivations on n worker processes (worker.hpp), forked from this one unless
+--worker-socket is given, in which case n SHE_worker processes are expected to connect to that path.
+*/
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.hpp"
+#include "logistic.hpp"
+#include "numa.hpp"
+#include "server.hpp"
+#include "wire.hpp"
+#include "params.hpp"
+#include "worker.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  if(argc < 9) {
+    cout << "Usage: " << argv[0] << " <cloud key> <weights csv> <coefs csv> <dim> <bits> <scale factor> <inputs> <outputs> [--checkpoint <dir>] [--resume] [--numa] [--workers <n>] [--worker-socket <path>]" << endl;
+    return 1;
+  }
+  string checkpoint_dir, worker_socket;
+  bool resume = false, numa = false;
+  int workers = 0;
+  for(int i = 9; i < argc; i++) {
+    if(strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) checkpoint_dir = argv[++i];
+    else if(strcmp(argv[i], "--resume") == 0) resume = true;
+    else if(strcmp(argv[i], "--numa") == 0) numa = true;
+    else if(strcmp(argv[i], "--workers") == 0 && i + 1 < argc) workers = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--worker-socket") == 0 && i + 1 < argc) worker_socket = argv[++i];
+  }
+  if(resume && checkpoint_dir.empty()) {
+    cout << "Error: --resume needs --checkpoint <dir>" << endl;
+    return 1;
+  }
+
+  const TFheGateBootstrappingCloudKeySet* ck = loadCloudKeyMapped(argv[1]);
+  if(ck == NULL) return 1;
+  // before any thread is started, see WorkerPool
+  WorkerPool *pool = NULL;
+  if(workers > 0) {
+    const bool spawn = worker_socket.empty();
+    if(spawn) worker_socket = "/tmp/SHE_batch." + to_string(getpid()) + ".sock";
+    pool = new WorkerPool(workers, ck, worker_socket, spawn);
+    if(pool->size() < workers) {
+      delete pool;
+      return 1;
+    }
+  }
+  if(numa) {
+    if(bindThreads() < 0) return 1;
+    const int replicas = replicateKey(ck);
+    if(replicas < 0) return 1;
+    cout << "Cloud key replicated on " << replicas << " NUMA nodes" << endl;
+  }
+  const int dim = atoi(argv[4]);
+  const size_t size = atoi(argv[5]);
+  ApproxLogRegression model(argv[2], argv[3], dim, ck, size, atoi(argv[6]));
+
+  int in = open(argv[7], O_RDONLY);
+  if(in < 0) {
+    cout << "Error: failed to open file." << endl;
+    return 1;
+  }
+  vector<LweSample**> X;
+  // seeded inputs stay compressed until the evaluation starts
+  vector<SeededSamples> seeded;
+  vector<int> seeded_at;
+  WireHeader header;
+  int status;
+  while((status = readHeader(in, header)) == 0) {
+    if((header.op & ~WIRE_SEEDED) != SERVER_PREDICT || (int) header.count != dim || header.size != size || header.params != paramsId(ck->params)) {
+      cout << "Error: sample " << X.size() << " does not match the model." << endl;
+      return 1;
+    }
+    if(header.op & WIRE_SEEDED) {
+      seeded.push_back(SeededSamples());
+      if(readSeededSamples(in, seeded.back(), dim * size) < 0) {
+        cout << "Error: sample " << X.size() << " is truncated." << endl;
+        return 1;
+      }
+      seeded_at.push_back(X.size());
+      X.push_back(NULL);
+      continue;
+    }
+    LweSample **x = new LweSample*[dim];
+    for(int i = 0; i < dim; i++) {
+      x[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+      if(readSamples(in, x[i], size, ck->params->in_out_params) < 0) {
+        cout << "Error: sample " << X.size() << " is truncated." << endl;
+        return 1;
+      }
+    }
+    X.push_back(x);
+  }
+  close(in);
+  if(status < 0) {
+    cout << "Error: the header of sample " << X.size() << " is truncated or corrupt." << endl;
+    return 1;
+  }
+  for(size_t q = 0; q < seeded.size(); q++) {
+    LweSample **x = new LweSample*[dim];
+    for(int i = 0; i < dim; i++) {
+      x[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+      expandSeeded(x[i], seeded[q], i * size, size, ck->params->in_out_params);
+    }
+    X[seeded_at[q]] = x;
+  }
+  seeded.clear();
+
+  const int count = X.size();
+  vector<LweSample*> y(count);
+  for(int s = 0; s < count; s++) {
+    y[s] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  }
+  Checkpointer *checkpoint = NULL;
+  if(!checkpoint_dir.empty()) {
+    // checkpoints belong to this model and these inputs
+    uint64_t run = CHECKPOINT_HASH_SEED;
+    const int32_t shape[3] = {dim, (int32_t) size, atoi(argv[6])};
+    run = checkpointHash(shape, sizeof(shape), run);
+    if(checkpointHashFile(argv[2], run) < 0 || checkpointHashFile(argv[3], run) < 0 || checkpointHashFile(argv[7], run) < 0) {
+      cout << "Error: failed to read the model or the inputs." << endl;
+      return 1;
+    }
+    checkpoint = new Checkpointer(checkpoint_dir, run, ck, resume);
+  }
+  model.predict_batch(y.data(), X.data(), count, checkpoint, pool);
+  delete checkpoint;
+  delete pool;
+  if(numa) releaseReplicas();
+
+  int out = open(argv[8], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(out < 0) {
+    cout << "Error: failed to open file." << endl;
+    return 1;
+  }
+  for(int s = 0; s < count; s++) {
+    if(writeHeader(out, SERVER_RESULT, 1, size, paramsId(ck->params)) < 0 || writeSamples(out, y[s], size, ck->params->in_out_params) < 0) {
+      cout << "Error: failed to write the result of sample " << s << "." << endl;
+      close(out);
+      return 1;
+    }
+  }
+  if(close(out) < 0) {
+    cout << "Error: failed to write the results." << endl;
+    return 1;
+  }
+  return 0;
+}
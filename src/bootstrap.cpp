@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <vector>
+#include "bootstrap.hpp"
+#include "numa.hpp"
+/*
+Batched bootstrapping. Follows tfhe_bootstrap_FFT / lweKeySwitch from libtfhe, but swaps the loop order:
+the loop over the rows of the bootstrapping (resp. key switching) key is the outer loop, and the loop over
+the samples of a batch is the inner loop. Each thread owns a contiguous slice of the batch, so a key row is
+read once per slice instead of once per gate.
+
+Reference: tfhe/src/libtfhe/lwe-bootstrapping-functions-fft.cpp, lwe-keyswitch-functions.cpp
+*/
+
+/* Per-thread buffers of blindRotateSlice, for slices of up to capacity samples. Reused from one chunk to the next */
+struct RotateBuffers {
+  const int capacity, n;
+  const TLweParams *accum_params;
+  TorusPolynomial *testvectbis;
+  TLweSample *acc, *tmp;
+  TLweSample **cur, **next;
+  int32_t *bara;
+
+  RotateBuffers(const int capacity, const LweBootstrappingKeyFFT* bk)
+    : capacity(capacity), n(bk->in_out_params->n), accum_params(bk->accum_params) {
+    testvectbis = new_TorusPolynomial(accum_params->N);
+    acc = new_TLweSample_array(capacity, accum_params);
+    tmp = new_TLweSample_array(capacity, accum_params);
+    cur = new TLweSample*[capacity];
+    next = new TLweSample*[capacity];
+    bara = new int32_t[(size_t) capacity * n];
+  }
+  ~RotateBuffers() {
+    delete[] bara;
+    delete[] next;
+    delete[] cur;
+    delete_TLweSample_array(capacity, tmp);
+    delete_TLweSample_array(capacity, acc);
+    delete_TorusPolynomial(testvectbis);
+  }
+  RotateBuffers(const RotateBuffers&) = delete;
+  RotateBuffers& operator=(const RotateBuffers&) = delete;
+};
+
+/*
+ * Blind-rotates x[lo..hi) with test vector testvect and extracts the results to u[lo..hi)
+ * u is in the extracted LWE parameters of the accumulator. hi - lo is at most buf.capacity
+*/
+static void blindRotateSlice(LweSample** u, const LweSample* x, const TorusPolynomial* testvect, const int lo, const int hi, RotateBuffers& buf, const LweBootstrappingKeyFFT* bk) {
+  const TGswParams *bk_params = bk->bk_params;
+  const TLweParams *accum_params = bk->accum_params;
+  const LweParams *extract_params = &accum_params->extracted_lweparams;
+  const int32_t Nx2 = 2 * accum_params->N;
+  const int32_t n = bk->in_out_params->n;
+  const int count = hi - lo;
+  TLweSample **cur = buf.cur, **next = buf.next;
+  int32_t *bara = buf.bara;
+
+  // modulus switching, then acc = X^{2N-barb} * testvec
+  for(int k = 0; k < count; k++) {
+    const LweSample *xk = &x[lo + k];
+    const int32_t barb = modSwitchFromTorus32(xk->b, Nx2);
+    for(int32_t i = 0; i < n; i++) {
+      bara[k*n + i] = modSwitchFromTorus32(xk->a[i], Nx2);
+    }
+    if(barb != 0) torusPolynomialMulByXai(buf.testvectbis, Nx2 - barb, testvect);
+    else torusPolynomialCopy(buf.testvectbis, testvect);
+    tLweNoiselessTrivial(&buf.acc[k], buf.testvectbis, accum_params);
+    cur[k] = &buf.acc[k];
+    next[k] = &buf.tmp[k];
+  }
+
+  // blind rotation: ACC_k = BK_i * [(X^bara_ki - 1) * ACC_k] + ACC_k for every k, before moving to BK_{i+1}
+  for(int32_t i = 0; i < n; i++) {
+    const TGswSampleFFT *bki = bk->bkFFT + i;
+    for(int k = 0; k < count; k++) {
+      const int32_t barai = bara[k*n + i];
+      if(barai == 0) continue;
+      tfhe_MuxRotate_FFT(next[k], cur[k], bki, barai, bk_params);
+      std::swap(cur[k], next[k]);
+    }
+  }
+
+  for(int k = 0; k < count; k++) {
+    tLweExtractLweSample(u[lo + k], cur[k], extract_params, accum_params);
+  }
+}
+
+/*
+ * Key switches u[lo..hi) to result[lo..hi), reading each row of the key switching key once for the slice.
+ * The rows come from the flat table of a NUMA replica (numa.hpp) if ks has one
+*/
+static void keySwitchSlice(LweSample** result, const LweSample* u, const int lo, const int hi, const LweKeySwitchKey* ks) {
+  const LweParams *params = ks->out_params;
+  const int32_t n = ks->n;
+  const int32_t t = ks->t;
+  const int32_t basebit = ks->basebit;
+  const int32_t base = 1 << basebit;
+  const int32_t prec_offset = 1 << (32 - (1 + basebit * t));
+  const int32_t mask = base - 1;
+  const KeySwitchTable *table = keySwitchTable(ks);
+  const int32_t m = params->n;
+
+  for(int k = lo; k < hi; k++) {
+    lweNoiselessTrivial(result[k], u[k].b, params);
+  }
+  for(int32_t i = 0; i < n; i++) {
+    for(int32_t j = 0; j < t; j++) {
+      const LweSample *row = ks->ks[i][j];
+      for(int k = lo; k < hi; k++) {
+        const uint32_t aibar = u[k].a[i] + prec_offset;
+        const uint32_t aij = (aibar >> (32 - (j + 1) * basebit)) & mask;
+        if(aij == 0) continue;
+        if(table == NULL) {
+          lweSubTo(result[k], &row[aij], params);
+          continue;
+        }
+        const int32_t *flat = table->samples + (((size_t) i * t + j) * base + aij) * (m + 1);
+        result[k]->b -= flat[0];
+        for(int32_t x = 0; x < m; x++) result[k]->a[x] -= flat[x + 1];
+        result[k]->current_variance += table->variance;
+      }
+    }
+  }
+}
+
+/*
+ * The batch is rotated in chunks of BOOTSTRAP_CHUNK samples, each split in one slice per thread, so the accumulators
+ * in flight are bounded whatever count is. Each thread allocates its buffers once for all the chunks
+*/
+void batchBootstrap_woKS(LweSample** result, const LweSample* x, const TorusPolynomial* testvect, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(count <= 0) return;
+  const int chunk = std::min(count, BOOTSTRAP_CHUNK);
+  const int slices = std::min(chunk, NUM_THREADS);
+  #pragma omp parallel num_threads(slices)
+  {
+    RotateBuffers buf((chunk + slices - 1) / slices, localKey(ck)->bkFFT);
+    for(int lo = 0; lo < count; lo += chunk) {
+      const int len = std::min(chunk, count - lo);
+      #pragma omp for
+      for(int s = 0; s < slices; s++) {
+        blindRotateSlice(result, x, testvect, lo + len * s / slices, lo + len * (s+1) / slices, buf, localKey(ck)->bkFFT);
+      }
+    }
+  }
+}
+
+void batchBootstrap_woKS(LweSample** result, const LweSample* x, const Torus32 mu, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  const int32_t N = ck->bkFFT->accum_params->N;
+  TorusPolynomial *testvect = new_TorusPolynomial(N);
+  // the initial testvec = [mu,mu,mu,...,mu]
+  for(int32_t i = 0; i < N; i++) testvect->coefsT[i] = mu;
+  batchBootstrap_woKS(result, x, testvect, count, ck);
+  delete_TorusPolynomial(testvect);
+}
+
+void batchKeySwitch(LweSample** result, const LweSample* u, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  const int slices = std::min(count, NUM_THREADS);
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(int s = 0; s < slices; s++) {
+    keySwitchSlice(result, u, count * s / slices, count * (s+1) / slices, localKey(ck)->bkFFT->ks);
+  }
+}
+
+/* Rotated and key switched one chunk at a time, through one chunk of extracted samples */
+void batchBootstrap(LweSample** result, const LweSample* x, const TorusPolynomial* testvect, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(count <= 0) return;
+  const LweParams *extract_params = &ck->bkFFT->accum_params->extracted_lweparams;
+  const int chunk = std::min(count, BOOTSTRAP_CHUNK);
+  LweSample *u = new_LweSample_array(chunk, extract_params);
+  std::vector<LweSample*> u_ptr(chunk);
+  for(int k = 0; k < chunk; k++) u_ptr[k] = &u[k];
+
+  for(int lo = 0; lo < count; lo += chunk) {
+    const int len = std::min(chunk, count - lo);
+    batchBootstrap_woKS(u_ptr.data(), x + lo, testvect, len, ck);
+    batchKeySwitch(result + lo, u, len, ck);
+  }
+
+  delete_LweSample_array(chunk, u);
+}
+
+void batchBootstrap(LweSample** result, const LweSample* x, const Torus32 mu, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(count <= 0) return;
+  const int32_t N = ck->bkFFT->accum_params->N;
+  TorusPolynomial *testvect = new_TorusPolynomial(N);
+  for(int32_t i = 0; i < N; i++) testvect->coefsT[i] = mu;
+  batchBootstrap(result, x, testvect, count, ck);
+  delete_TorusPolynomial(testvect);
+}
+
+int knownBit(const LweSample* x, const LweParams* params) {
+  static const Torus32 MU = modSwitchToTorus32(1, 8);
+  if(x->current_variance != 0 || (x->b != MU && x->b != -MU)) return -1;
+  for(int32_t i = 0; i < params->n; i++) {
+    if(x->a[i] != 0) return -1;
+  }
+  return x->b == MU;
+}
+
+/* Writes the folded value of a gate (circuits.hpp), as a trivial sample, a copy or a negation of an input */
+static void foldTo(LweSample* result, const GateFold f, const LweSample* s, const LweSample* a, const LweSample* b, const LweParams* params) {
+  static const Torus32 MU = modSwitchToTorus32(1, 8);
+  switch(f) {
+    case FOLD_ZERO: lweNoiselessTrivial(result, -MU, params); break;
+    case FOLD_ONE: lweNoiselessTrivial(result, MU, params); break;
+    case FOLD_A: lweCopy(result, a, params); break;
+    case FOLD_NOT_A: lweNegate(result, a, params); break;
+    case FOLD_B: lweCopy(result, b, params); break;
+    case FOLD_NOT_B: lweNegate(result, b, params); break;
+    case FOLD_S: lweCopy(result, s, params); break;
+    case FOLD_NOT_S: lweNegate(result, s, params); break;
+    case FOLD_NONE: break;
+  }
+}
+
+/*
+ * Mixed batch: result[k] = ops[k](a[k], b[k]). All the gates share the test vector +-1/8 and differ only in the
+ * linear combination taken before the bootstrap, so any mix of them is blind-rotated together.
+ * Gates with a known input are folded instead (knownBit). Both the linear combinations and the folded values are
+ * computed before any output is written, so result may alias a or b
+*/
+void bootsGATE_batch(LweSample** result, const GateOp* ops, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(count <= 0) return;
+  static const Torus32 MU = modSwitchToTorus32(1, 8);
+  // offset, pa, pb per GateOp, in enum order
+  static const Torus32 offset[] = {modSwitchToTorus32(-1, 8), modSwitchToTorus32(1, 8), modSwitchToTorus32(1, 8), modSwitchToTorus32(-1, 8),
+                                   modSwitchToTorus32(1, 4), modSwitchToTorus32(-1, 4), modSwitchToTorus32(-1, 8), modSwitchToTorus32(-1, 8),
+                                   modSwitchToTorus32(1, 8), modSwitchToTorus32(1, 8)};
+  static const int32_t pa[] = {1, 1, -1, -1, 2, -2, -1, 1, -1, 1},
+                       pb[] = {1, 1, -1, -1, 2, -2, 1, -1, 1, -1};
+  const LweParams *in_out_params = ck->params->in_out_params;
+  std::vector<GateFold> fold(count);
+  std::vector<int> boot, folded;
+  for(int k = 0; k < count; k++) {
+    fold[k] = foldGate(ops[k], knownBit(a[k], in_out_params), knownBit(b[k], in_out_params));
+    (fold[k] == FOLD_NONE ? boot : folded).push_back(k);
+  }
+  const int m = boot.size(), f = folded.size();
+  LweSample *temp = new_LweSample_array(m, in_out_params);
+  LweSample *staged = new_LweSample_array(f, in_out_params);
+  std::vector<LweSample*> r(m);
+  for(int j = 0; j < m; j++) {
+    const int k = boot[j];
+    lweNoiselessTrivial(&temp[j], offset[ops[k]], in_out_params);
+    lweAddMulTo(&temp[j], pa[ops[k]], a[k], in_out_params);
+    lweAddMulTo(&temp[j], pb[ops[k]], b[k], in_out_params);
+    r[j] = result[k];
+  }
+  for(int j = 0; j < f; j++) {
+    const int k = folded[j];
+    foldTo(&staged[j], fold[k], NULL, a[k], b[k], in_out_params);
+  }
+  batchBootstrap(r.data(), temp, MU, m, ck);
+  for(int j = 0; j < f; j++) {
+    lweCopy(result[folded[j]], &staged[j], in_out_params);
+  }
+  delete_LweSample_array(f, staged);
+  delete_LweSample_array(m, temp);
+}
+
+/* Shared body of the single-gate batches */
+static void gate_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count,
+                       const GateOp op, const TFheGateBootstrappingCloudKeySet* ck) {
+  std::vector<GateOp> ops(count, op);
+  bootsGATE_batch(result, ops.data(), a, b, count, ck);
+}
+
+void bootsAND_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_AND, ck);
+}
+
+void bootsOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_OR, ck);
+}
+
+void bootsNAND_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_NAND, ck);
+}
+
+void bootsNOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_NOR, ck);
+}
+
+void bootsXOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_XOR, ck);
+}
+
+void bootsXNOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_XNOR, ck);
+}
+
+void bootsANDNY_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_ANDNY, ck);
+}
+
+void bootsANDYN_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_ANDYN, ck);
+}
+
+void bootsORNY_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_ORNY, ck);
+}
+
+void bootsORYN_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  gate_batch(result, a, b, count, GATE_ORYN, ck);
+}
+
+/*
+ * MUX(a,b,c) = AND(a,b) + AND(not(a),c), as in bootsMUX: both halves of all count gates are
+ * blind-rotated as one batch of 2*count, summed, and key switched as a second batch.
+ * A known select, or known b and c, fold the whole MUX; a half on a known 0 b or c is the trivial -1/8 and is not rotated
+*/
+void bootsMUX_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const LweSample* const* c, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(count <= 0) return;
+  static const Torus32 MU = modSwitchToTorus32(1, 8);
+  static const Torus32 AndConst = modSwitchToTorus32(-1, 8);
+  static const Torus32 MuxConst = modSwitchToTorus32(1, 8);
+  const LweParams *in_out_params = ck->params->in_out_params;
+  const LweParams *extracted_params = &ck->params->tgsw_params->tlwe_params->extracted_lweparams;
+
+  std::vector<GateFold> fold(count);
+  std::vector<int> kb(count), kc(count), mux, folded;
+  for(int k = 0; k < count; k++) {
+    kb[k] = knownBit(b[k], in_out_params);
+    kc[k] = knownBit(c[k], in_out_params);
+    fold[k] = foldMux(knownBit(a[k], in_out_params), kb[k], kc[k]);
+    (fold[k] == FOLD_NONE ? mux : folded).push_back(k);
+  }
+  const int m = mux.size(), f = folded.size();
+  LweSample *temp = new_LweSample_array(2*m, in_out_params);
+  LweSample *u = new_LweSample_array(2*m, extracted_params);
+  LweSample *v = new_LweSample_array(m, extracted_params);
+  LweSample *staged = new_LweSample_array(f, in_out_params);
+  std::vector<LweSample*> u_ptr, r(m);
+  for(int j = 0; j < m; j++) {
+    const int k = mux[j];
+    //compute "AND(a,b)": (0,-1/8) + a + b
+    if(kb[k] != 0) {
+      LweSample *t = &temp[u_ptr.size()];
+      lweNoiselessTrivial(t, AndConst, in_out_params);
+      lweAddTo(t, a[k], in_out_params);
+      lweAddTo(t, b[k], in_out_params);
+      u_ptr.push_back(&u[j]);
+    }
+    else lweNoiselessTrivial(&u[j], AndConst, extracted_params);
+    //compute "AND(not(a),c)": (0,-1/8) - a + c
+    if(kc[k] != 0) {
+      LweSample *t = &temp[u_ptr.size()];
+      lweNoiselessTrivial(t, AndConst, in_out_params);
+      lweSubTo(t, a[k], in_out_params);
+      lweAddTo(t, c[k], in_out_params);
+      u_ptr.push_back(&u[m + j]);
+    }
+    else lweNoiselessTrivial(&u[m + j], AndConst, extracted_params);
+    r[j] = result[k];
+  }
+  for(int j = 0; j < f; j++) {
+    const int k = folded[j];
+    foldTo(&staged[j], fold[k], a[k], b[k], c[k], in_out_params);
+  }
+  batchBootstrap_woKS(u_ptr.data(), temp, MU, u_ptr.size(), ck);
+
+  for(int j = 0; j < m; j++) {
+    lweNoiselessTrivial(&v[j], MuxConst, extracted_params);
+    lweAddTo(&v[j], &u[j], extracted_params);
+    lweAddTo(&v[j], &u[m + j], extracted_params);
+  }
+  batchKeySwitch(r.data(), v, m, ck);
+  for(int j = 0; j < f; j++) {
+    lweCopy(result[folded[j]], &staged[j], in_out_params);
+  }
+
+  delete_LweSample_array(f, staged);
+  delete_LweSample_array(m, v);
+  delete_LweSample_array(2*m, u);
+  delete_LweSample_array(2*m, temp);
+}
+
+/*
+ * Array forms. Build the pointer tables and forward to the gather forms
+*/
+#define ARRAY_GATE_BATCH(GATE) \
+void GATE##_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) { \
+  std::vector<LweSample*> r(count); \
+  std::vector<const LweSample*> x(count), y(count); \
+  for(int k = 0; k < count; k++) { r[k] = &result[k]; x[k] = &a[k]; y[k] = &b[k]; } \
+  GATE##_batch(r.data(), x.data(), y.data(), count, ck); \
+}
+
+ARRAY_GATE_BATCH(bootsAND)
+ARRAY_GATE_BATCH(bootsOR)
+ARRAY_GATE_BATCH(bootsNAND)
+ARRAY_GATE_BATCH(bootsNOR)
+ARRAY_GATE_BATCH(bootsXOR)
+ARRAY_GATE_BATCH(bootsXNOR)
+ARRAY_GATE_BATCH(bootsANDNY)
+ARRAY_GATE_BATCH(bootsANDYN)
+ARRAY_GATE_BATCH(bootsORNY)
+ARRAY_GATE_BATCH(bootsORYN)
+
+void bootsMUX_batch(LweSample* result, const LweSample* a, const LweSample* b, const LweSample* c, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  std::vector<LweSample*> r(count);
+  std::vector<const LweSample*> x(count), y(count), z(count);
+  for(int k = 0; k < count; k++) { r[k] = &result[k]; x[k] = &a[k]; y[k] = &b[k]; z[k] = &c[k]; }
+  bootsMUX_batch(r.data(), x.data(), y.data(), z.data(), count, ck);
+}
@@ -0,0 +1,77 @@
+/**
+    * Implements batched gate bootstrapping.
+    * A single bootsAND/bootsXOR/... streams the whole FFT bootstrapping key through the cache.
+    * The batched gates below blind-rotate K independent samples together, so each row of the
+    * bootstrapping key is loaded once per chunk of BOOTSTRAP_CHUNK samples and applied to all their accumulators.
+
+*/
+
+#pragma once
+
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+#include "circuits.hpp"
+#include "omp_constants.hpp"
+
+// Bootstraps count samples x[0..count-1] to +-mu, with and without the final key switch.
+// result[i] of batchBootstrap_woKS lives in the extracted (N-dimensional) LWE parameters.
+void batchBootstrap(LweSample** result, const LweSample* x, const Torus32 mu, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void batchBootstrap_woKS(LweSample** result, const LweSample* x, const Torus32 mu, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+// Same, with an arbitrary test vector: the constant term of X^{-phase(x)} * testvect is extracted (programmable bootstrapping)
+void batchBootstrap(LweSample** result, const LweSample* x, const TorusPolynomial* testvect, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void batchBootstrap_woKS(LweSample** result, const LweSample* x, const TorusPolynomial* testvect, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+// Key switches count samples u[0..count-1] from the extracted parameters back to the gate parameters
+void batchKeySwitch(LweSample** result, const LweSample* u, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+
+// Public bits: 0 or 1 if x is a noiseless trivial sample (a = 0, b = +-1/8: bootsCONSTANT, and NOT / COPY of one),
+// -1 for an encryption. current_variance == 0 is checked first, so encryptions are rejected without reading a
+int knownBit(const LweSample* x, const LweParams* params);
+
+// Gather forms: result[i] = GATE(a[i], b[i]). Inputs and outputs may be scattered in memory.
+// Every gate and MUX with known inputs (knownBit) is folded to a constant, copy or NOT instead of bootstrapped, so
+// the zero bits of shifts, CONSTANT weights and carries in cost nothing.
+void bootsAND_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsNAND_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsNOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsXOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsXNOR_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsANDNY_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsANDYN_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsORNY_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsORYN_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsMUX_batch(LweSample** result, const LweSample* const* a, const LweSample* const* b, const LweSample* const* c, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+// Mixed form: result[i] = ops[i](a[i], b[i]), any mix of the gates above in one batch
+void bootsGATE_batch(LweSample** result, const GateOp* ops, const LweSample* const* a, const LweSample* const* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+
+// Array forms: result[i] = GATE(a[i], b[i]) over contiguous ciphertext arrays
+void bootsAND_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsOR_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsNAND_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsNOR_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsXOR_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsXNOR_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsANDNY_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsANDYN_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsORNY_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsORYN_batch(LweSample* result, const LweSample* a, const LweSample* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void bootsMUX_batch(LweSample* result, const LweSample* a, const LweSample* b, const LweSample* c, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+
+/** Gate backend of circuits.hpp over the batched gates */
+struct TfheBackend {
+  typedef LweSample Bit;
+  const TFheGateBootstrappingCloudKeySet* ck;
+
+  TfheBackend(const TFheGateBootstrappingCloudKeySet* ck) : ck(ck) {}
+
+  Bit* alloc(size_t n) { return new_gate_bootstrapping_ciphertext_array(n, ck->params); }
+  void release(Bit* x, size_t n) { delete_gate_bootstrapping_ciphertext_array(n, x); }
+
+  void gates(Bit** r, const GateOp* ops, const Bit* const* a, const Bit* const* b, int count) { bootsGATE_batch(r, ops, a, b, count, ck); }
+  void mux(Bit** r, const Bit* const* s, const Bit* const* a, const Bit* const* b, int count) { bootsMUX_batch(r, s, a, b, count, ck); }
+  void NOT(Bit* r, const Bit* a) { bootsNOT(r, a, ck); }
+  void COPY(Bit* r, const Bit* a) { bootsCOPY(r, a, ck); }
+  void CONSTANT(Bit* r, int v) { bootsCONSTANT(r, v, ck); }
+};
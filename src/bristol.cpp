@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bristol.hpp"
+
+using namespace std;
+
+/*
+Bristol Fashion:                       Bristol (old):
+  <gates> <wires>                        <gates> <wires>
+  <niv> <bits of input 1> ...            <bits of input 1> <bits of input 2> <bits of output>
+  <nov> <bits of output 1> ...
+                                         <nin> <nout> <in wires> <out wires> XOR|AND|INV
+  <nin> <nout> <in wires> <out wires> XOR|AND|INV|EQ|EQW|MAND
+*/
+
+static vector<string> tokenize(const string& line) {
+  istringstream stream(line);
+  vector<string> tokens;
+  string token;
+  while(stream >> token) tokens.push_back(token);
+  return tokens;
+}
+
+static bool isNumeric(const vector<string>& tokens) {
+  if(tokens.empty()) return false;
+  for(const string& t: tokens) {
+    if(t.find_first_not_of("0123456789") != string::npos) return false;
+  }
+  return true;
+}
+
+static bool nextNonEmpty(ifstream& file, vector<string>& tokens) {
+  string line;
+  while(getline(file, line)) {
+    tokens = tokenize(line);
+    if(!tokens.empty()) return true;
+  }
+  return false;
+}
+
+/*
+Appends gate out = op(in0, in1) with constant folding: known[w] is the value of wire w, or -1 if it is encrypted
+*/
+static void emit(BristolCircuit& circuit, vector<int>& known, vector<int>& level, BristolGate::Op op, int in0, int in1, int out) {
+  BristolGate g;
+  g.op = op; g.in0 = in0; g.in1 = in1; g.out = out;
+  int k0 = (op == BristolGate::CONST) ? in0 : known[in0],
+      k1 = (op == BristolGate::XOR || op == BristolGate::AND || op == BristolGate::OR) ? known[in1] : -1;
+
+  if(op == BristolGate::XOR || op == BristolGate::AND || op == BristolGate::OR) {
+    // put the known input, if any, first
+    if(k0 < 0 && k1 >= 0) { swap(g.in0, g.in1); swap(k0, k1); }
+    if(k0 >= 0 && k1 >= 0) {
+      g.op = BristolGate::CONST;
+      g.in0 = op == BristolGate::XOR ? (k0 ^ k1) : (op == BristolGate::AND ? (k0 & k1) : (k0 | k1));
+    }
+    else if(k0 >= 0) {
+      if(op == BristolGate::XOR) g.op = k0 ? BristolGate::NOT : BristolGate::COPY;
+      else if(op == BristolGate::AND) g.op = k0 ? BristolGate::COPY : BristolGate::CONST;
+      else g.op = k0 ? BristolGate::CONST : BristolGate::COPY;
+      if(g.op == BristolGate::CONST) g.in0 = k0;
+      else g.in0 = g.in1;
+    }
+  }
+  else if(op == BristolGate::COPY || op == BristolGate::NOT) {
+    if(k0 >= 0) {
+      g.op = BristolGate::CONST;
+      g.in0 = op == BristolGate::NOT ? !k0 : k0;
+    }
+  }
+
+  switch(g.op) {
+    case BristolGate::CONST:
+      known[out] = g.in0;
+      g.level = 0;
+      break;
+    case BristolGate::COPY:
+    case BristolGate::NOT:
+      g.level = level[g.in0];
+      break;
+    default:
+      g.level = max(level[g.in0], level[g.in1]) + 1;
+      circuit.num_bootstrapped++;
+      break;
+  }
+  level[out] = g.level;
+  circuit.depth = max(circuit.depth, g.level);
+  circuit.gates.push_back(g);
+}
+
+/* Expected (inputs, outputs) of a gate line, false for an unknown gate. MAND has any even nin = 2 * nout */
+static bool gateArity(const string& name, const int nin, const int nout) {
+  if(name == "XOR" || name == "AND" || name == "OR") return nin == 2 && nout == 1;
+  if(name == "INV" || name == "NOT" || name == "EQW" || name == "EQ") return nin == 1 && nout == 1;
+  if(name == "MAND") return nout > 0 && nin == 2 * nout;
+  return false;
+}
+
+/* Body of readBristol. std::stoi throws on tokens that are not numbers or do not fit in an int */
+static int parseBristol(BristolCircuit& circuit, ifstream& file, bool msb_first) {
+  vector<string> header, line2, line3;
+  if(!nextNonEmpty(file, header) || header.size() < 2 || !nextNonEmpty(file, line2) || !isNumeric(line2)) {
+    cout << "Error: malformed Bristol header." << endl;
+    return -1;
+  }
+  int num_gates = stoi(header[0]);
+  circuit.num_wires = stoi(header[1]);
+  circuit.input_widths.clear();
+  circuit.output_widths.clear();
+  circuit.gates.clear();
+  circuit.depth = 0;
+  circuit.num_bootstrapped = 0;
+  circuit.msb_first = msb_first;
+  if(num_gates < 0 || circuit.num_wires < 1) {
+    cout << "Error: malformed Bristol header." << endl;
+    return -1;
+  }
+
+  // Bristol Fashion has a separate, all-numeric output line; the old format goes straight to the gates
+  streampos gates_start = file.tellg();
+  bool fashion = nextNonEmpty(file, line3) && isNumeric(line3) && (size_t) stoi(line3[0]) + 1 == line3.size()
+                 && (size_t) stoi(line2[0]) + 1 == line2.size();
+  if(fashion) {
+    for(size_t i = 1; i < line2.size(); i++) circuit.input_widths.push_back(stoi(line2[i]));
+    for(size_t i = 1; i < line3.size(); i++) circuit.output_widths.push_back(stoi(line3[i]));
+  }
+  else {
+    if(line2.size() != 3) {
+      cout << "Error: malformed Bristol header." << endl;
+      return -1;
+    }
+    circuit.input_widths.push_back(stoi(line2[0]));
+    circuit.input_widths.push_back(stoi(line2[1]));
+    circuit.output_widths.push_back(stoi(line2[2]));
+    file.clear();
+    file.seekg(gates_start);
+  }
+  // inputs take the first wires and outputs the last ones
+  long io_wires = 0;
+  for(int width: circuit.input_widths) io_wires += width;
+  for(int width: circuit.output_widths) io_wires += width;
+  if(io_wires > circuit.num_wires) {
+    cout << "Error: " << io_wires << " input and output wires, the circuit has " << circuit.num_wires << "." << endl;
+    return -1;
+  }
+
+  vector<int> known(circuit.num_wires, -1), level(circuit.num_wires, 0);
+  vector<string> tokens;
+  for(int g = 0; g < num_gates; g++) {
+    if(!nextNonEmpty(file, tokens) || tokens.size() < 3) {
+      cout << "Error: expected " << num_gates << " gates, got " << g << "." << endl;
+      return -1;
+    }
+    const int nin = stoi(tokens[0]), nout = stoi(tokens[1]);
+    const string& name = tokens.back();
+    if(nin < 0 || nout < 0 || tokens.size() != (size_t) nin + nout + 3) {
+      cout << "Error: malformed gate line " << g << "." << endl;
+      return -1;
+    }
+    if(!gateArity(name, nin, nout)) {
+      cout << "Error: unsupported gate " << name << " with " << nin << " inputs and " << nout << " outputs." << endl;
+      return -1;
+    }
+    vector<int> w;
+    for(int i = 2; i < 2 + nin + nout; i++) w.push_back(stoi(tokens[i]));
+    // the input of EQ is the constant
+    for(size_t i = name == "EQ" ? 1 : 0; i < w.size(); i++) {
+      if(w[i] < 0 || w[i] >= circuit.num_wires) {
+        cout << "Error: wire " << w[i] << " of gate " << g << " is out of range." << endl;
+        return -1;
+      }
+    }
+
+    if(name == "XOR") emit(circuit, known, level, BristolGate::XOR, w[0], w[1], w[2]);
+    else if(name == "AND") emit(circuit, known, level, BristolGate::AND, w[0], w[1], w[2]);
+    else if(name == "OR") emit(circuit, known, level, BristolGate::OR, w[0], w[1], w[2]);
+    else if(name == "INV" || name == "NOT") emit(circuit, known, level, BristolGate::NOT, w[0], -1, w[1]);
+    else if(name == "EQW") emit(circuit, known, level, BristolGate::COPY, w[0], -1, w[1]);
+    else if(name == "EQ") {
+      if(w[0] != 0 && w[0] != 1) {
+        cout << "Error: EQ constant " << w[0] << " of gate " << g << " is not a bit." << endl;
+        return -1;
+      }
+      emit(circuit, known, level, BristolGate::CONST, w[0], -1, w[1]);
+    }
+    else {
+      // MAND: AND(in[i], in[nout+i]) -> out[i]
+      for(int i = 0; i < nout; i++) emit(circuit, known, level, BristolGate::AND, w[i], w[nout + i], w[nin + i]);
+    }
+  }
+  return 0;
+}
+
+int readBristol(BristolCircuit& circuit, string filepath, bool msb_first) {
+  ifstream file(filepath);
+  if(!file.is_open()) {
+    cout << "Error: failed to open file." << endl;
+    return -1;
+  }
+  int status;
+  try {
+    status = parseBristol(circuit, file, msb_first);
+  }
+  catch(const std::logic_error& e) {
+    // std::invalid_argument or std::out_of_range from stoi
+    cout << "Error: malformed number in " << filepath << "." << endl;
+    status = -1;
+  }
+  file.close();
+  return status;
+}
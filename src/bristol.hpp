@@ -0,0 +1,97 @@
+/**
+    * Imports and evaluates boolean circuits in Bristol and Bristol Fashion netlist format
+    * (https://homes.esat.kuleuven.be/~nsmart/MPC/), so gate-count-optimized adders, comparators and
+    * multipliers can be evaluated on encrypted bit vectors without hand-coding them in alu.cpp.
+    *
+    * At load time, constants (EQ gates) are propagated and every gate is assigned a level. Free gates
+    * (NOT, COPY, XOR/AND with a known constant) never bootstrap; the XOR/AND/OR gates of a level are
+    * independent and are bootstrapped together as batches.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "circuits.hpp"
+
+struct BristolGate {
+  enum Op { CONST, COPY, NOT, XOR, AND, OR };
+  Op op;
+  int in0, in1;  // input wires, or in0 = constant value for CONST
+  int out;  // output wire
+  int level;  // number of bootstrapped gates on the longest path to this gate
+};
+
+struct BristolCircuit {
+  int num_wires;
+  std::vector<int> input_widths;  // bits per input value, inputs occupy the first wires
+  std::vector<int> output_widths;  // bits per output value, outputs occupy the last wires
+  std::vector<BristolGate> gates;  // topological order
+  int depth;  // number of levels of bootstrapped gates
+  int num_bootstrapped;  // gates that cost a bootstrap
+  bool msb_first;  // wire order of each value. The ALU uses LSB first
+};
+
+// Parses Bristol or Bristol Fashion (detected from the header). Returns 0 on success, -1 on error
+int readBristol(BristolCircuit& circuit, std::string filepath, bool msb_first=false);
+
+/**
+  inputs[v] holds input_widths[v] bits, outputs[v] receives output_widths[v] bits, both LSB first.
+  The XOR/AND/OR gates of a level are one batch of be.gates(); on TFHE ciphertexts use TfheBackend (bootstrap.hpp)
+*/
+template<class B>
+void evalBristol(B& be, typename B::Bit* const* outputs, typename B::Bit* const* inputs, const BristolCircuit& circuit) {
+  typedef typename B::Bit Bit;
+  Bit *wires = be.alloc(circuit.num_wires);
+
+  int offset = 0;
+  for(size_t v = 0; v < circuit.input_widths.size(); v++) {
+    const int width = circuit.input_widths[v];
+    for(int b = 0; b < width; b++) {
+      be.COPY(&wires[offset + (circuit.msb_first ? width-1-b : b)], &inputs[v][b]);
+    }
+    offset += width;
+  }
+
+  std::vector<std::vector<const BristolGate*>> levels(circuit.depth + 1);
+  for(const BristolGate& g: circuit.gates) levels[g.level].push_back(&g);
+
+  std::vector<Bit*> r;
+  std::vector<const Bit*> x, y;
+  std::vector<GateOp> ops;
+  for(int l = 0; l <= circuit.depth; l++) {
+    // bootstrapped gates of a level only read wires of lower levels
+    r.clear(); x.clear(); y.clear(); ops.clear();
+    for(const BristolGate *g: levels[l]) {
+      if(g->op != BristolGate::XOR && g->op != BristolGate::AND && g->op != BristolGate::OR) continue;
+      ops.push_back(g->op == BristolGate::XOR ? GATE_XOR : (g->op == BristolGate::AND ? GATE_AND : GATE_OR));
+      r.push_back(&wires[g->out]);
+      x.push_back(&wires[g->in0]);
+      y.push_back(&wires[g->in1]);
+    }
+    if(!r.empty()) be.gates(r.data(), ops.data(), x.data(), y.data(), r.size());
+
+    // free gates of a level may read the outputs of the batch above, in file order
+    for(const BristolGate *g: levels[l]) {
+      switch(g->op) {
+        case BristolGate::CONST: be.CONSTANT(&wires[g->out], g->in0); break;
+        case BristolGate::COPY: be.COPY(&wires[g->out], &wires[g->in0]); break;
+        case BristolGate::NOT: be.NOT(&wires[g->out], &wires[g->in0]); break;
+        default: break;
+      }
+    }
+  }
+
+  int total_out = 0;
+  for(int width: circuit.output_widths) total_out += width;
+  offset = circuit.num_wires - total_out;
+  for(size_t v = 0; v < circuit.output_widths.size(); v++) {
+    const int width = circuit.output_widths[v];
+    for(int b = 0; b < width; b++) {
+      be.COPY(&outputs[v][b], &wires[offset + (circuit.msb_first ? width-1-b : b)]);
+    }
+    offset += width;
+  }
+
+  be.release(wires, circuit.num_wires);
+}
@@ -0,0 +1,177 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+#include "wire.hpp"
+#include "params.hpp"
+
+using namespace std;
+
+uint64_t checkpointHash(const void* data, const size_t len, uint64_t hash) {
+  const unsigned char *p = (const unsigned char*) data;
+  for(size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+int checkpointHashFile(const string& path, uint64_t& hash) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if(f == NULL) return -1;
+  char buf[1 << 16];
+  size_t len;
+  while((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+    hash = checkpointHash(buf, len, hash);
+  }
+  const int status = ferror(f) ? -1 : 0;
+  fclose(f);
+  return status;
+}
+
+/* "layer_<n>.ckpt" exactly, not the .tmp of an interrupted write */
+static bool isLayerFile(const char* name, int& layer) {
+  return sscanf(name, "layer_%d", &layer) == 1 && string(name) == "layer_" + to_string(layer) + ".ckpt";
+}
+
+Checkpointer::Checkpointer(string dir, const uint64_t run, const TFheGateBootstrappingCloudKeySet* ck, bool resume)
+  : dir(dir), run(run), ck(ck), stopping(false) {
+  mkdir(dir.c_str(), 0755);
+  if(!resume) {
+    vector<string> files;
+    DIR *d = opendir(dir.c_str());
+    if(d != NULL) {
+      struct dirent *entry;
+      int layer;
+      while((entry = readdir(d)) != NULL) {
+        if(isLayerFile(entry->d_name, layer)) files.push_back(dir + "/" + entry->d_name);
+      }
+      closedir(d);
+    }
+    for(const string& file: files) {
+      if(unlink(file.c_str()) < 0 && errno != ENOENT) {
+        cout << "Error: failed to remove checkpoint " << file << ": " << strerror(errno) << endl;
+        break;
+      }
+    }
+  }
+  writer = thread(&Checkpointer::writeLoop, this);
+}
+
+Checkpointer::~Checkpointer() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  changed.notify_all();
+  writer.join();
+}
+
+string Checkpointer::path(int layer) const {
+  return dir + "/layer_" + to_string(layer) + ".ckpt";
+}
+
+void Checkpointer::save(int layer, LweSample** values, const int count, const size_t size) {
+  const LweParams *params = ck->params->in_out_params;
+  Snapshot snapshot = {layer, new_LweSample_array(count * size, params), count, size};
+  for(int k = 0; k < count; k++) {
+    for(size_t b = 0; b < size; b++) {
+      lweCopy(&snapshot.values[k*size + b], &values[k][b], params);
+    }
+  }
+  {
+    lock_guard<mutex> guard(lock);
+    pending.push_back(snapshot);
+  }
+  changed.notify_all();
+}
+
+void Checkpointer::flush() {
+  unique_lock<mutex> guard(lock);
+  changed.wait(guard, [this] { return pending.empty(); });
+}
+
+/*
+The snapshot stays at the front of the queue while it is written, so flush() returns only once it is on disk
+*/
+void Checkpointer::writeLoop() {
+  const LweParams *params = ck->params->in_out_params;
+  while(true) {
+    Snapshot snapshot;
+    {
+      unique_lock<mutex> guard(lock);
+      changed.wait(guard, [this] { return stopping || !pending.empty(); });
+      if(pending.empty()) return;
+      snapshot = pending.front();
+    }
+    const string final_path = path(snapshot.layer), tmp_path = final_path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0
+              && writeHeader(fd, CHECKPOINT_LAYER, snapshot.count, snapshot.size, paramsId(ck->params)) == 0
+              && writeAll(fd, &run, sizeof(run)) == 0
+              && writeSamples(fd, snapshot.values, snapshot.count * snapshot.size, params) == 0
+              && fsync(fd) == 0;
+    if(fd >= 0) close(fd);
+    if(ok) ok = rename(tmp_path.c_str(), final_path.c_str()) == 0;
+    if(!ok) {
+      cout << "Error: failed to write checkpoint " << final_path << endl;
+      unlink(tmp_path.c_str());
+    }
+    delete_LweSample_array(snapshot.count * snapshot.size, snapshot.values);
+    {
+      lock_guard<mutex> guard(lock);
+      pending.pop_front();
+    }
+    changed.notify_all();
+  }
+}
+
+int Checkpointer::openLayer(int layer, WireHeader& header) const {
+  int fd = open(path(layer).c_str(), O_RDONLY);
+  if(fd < 0) return -1;
+  uint64_t file_run;
+  if(readHeader(fd, header) != 0 || header.op != CHECKPOINT_LAYER || header.params != paramsId(ck->params)
+     || readAll(fd, &file_run, sizeof(file_run)) < 0 || file_run != run) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int Checkpointer::lastLayer() const {
+  int last = -1;
+  DIR *d = opendir(dir.c_str());
+  if(d == NULL) return -1;
+  struct dirent *entry;
+  int layer;
+  while((entry = readdir(d)) != NULL) {
+    if(!isLayerFile(entry->d_name, layer) || layer <= last) continue;
+    WireHeader header;
+    int fd = openLayer(layer, header);
+    if(fd < 0) continue;
+    close(fd);
+    last = layer;
+  }
+  closedir(d);
+  return last;
+}
+
+int Checkpointer::load(int layer, LweSample** values, const int count, const size_t size) const {
+  const LweParams *params = ck->params->in_out_params;
+  WireHeader header;
+  int fd = openLayer(layer, header);
+  if(fd < 0) return -1;
+  int status = (int) header.count != count || header.size != size ? -1 : 0;
+  for(int k = 0; k < count && status == 0; k++) {
+    status = readSamples(fd, values[k], size, params);
+  }
+  close(fd);
+  return status;
+}
@@ -0,0 +1,84 @@
+/**
+    * Per-layer checkpoints of encrypted activations, so a long batch inference can resume from the last
+    * completed layer instead of the first one.
+    *
+    * save() snapshots the ciphertexts in memory and returns; a background thread writes the snapshot as
+    * <dir>/layer_<n>.ckpt in the wire format of wire.hpp (one header, then the samples). A file is written
+    * under a temporary name, synced, and renamed, so a layer file that exists is complete.
+    * The header is followed by the hash of the run (model and inputs, see checkpointHash): layer files of another
+    * run in the same directory are ignored.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "wire.hpp"
+
+#define CHECKPOINT_LAYER 32  // WireHeader op of a layer file
+#define CHECKPOINT_HASH_SEED 0xcbf29ce484222325ULL  // FNV-1a offset basis
+
+/** FNV-1a (64 bit) of len bytes, continuing from hash */
+uint64_t checkpointHash(const void* data, const size_t len, uint64_t hash=CHECKPOINT_HASH_SEED);
+/** Same over the contents of the file at path. Returns -1 if it cannot be read */
+int checkpointHashFile(const std::string& path, uint64_t& hash);
+
+class Checkpointer {
+  private:
+    struct Snapshot {
+      int layer;
+      LweSample* values;  // count * size samples
+      int count;
+      size_t size;
+    };
+
+    std::string dir;
+    uint64_t run;  // hash of the model and inputs
+    const TFheGateBootstrappingCloudKeySet* ck;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<Snapshot> pending;
+    bool stopping;
+    std::thread writer;
+
+    std::string path(int layer) const;
+    void writeLoop();
+    // opens a layer file and reads its header; -1 if it is missing, not a layer file or of another run
+    int openLayer(int layer, WireHeader& header) const;
+
+  public:
+
+    /**
+      run is the hash of the model and inputs of this run. If resume is false, layer files left in dir by an
+      earlier run are removed (an error is reported if one cannot be)
+    */
+    Checkpointer(std::string dir, const uint64_t run, const TFheGateBootstrappingCloudKeySet* ck, bool resume);
+    ~Checkpointer();
+
+    /**
+      Queues values[0..count-1] (size bits each) as layer `layer`
+    */
+    void save(int layer, LweSample** values, const int count, const size_t size);
+
+    /**
+      Blocks until every queued layer is on disk
+    */
+    void flush();
+
+    /**
+      Highest layer with a complete file of this run, -1 if there is none
+    */
+    int lastLayer() const;
+
+    /**
+      Reads layer `layer` into values[0..count-1]. Returns 0 on success, -1 if the file is missing, of another run or its shape differs
+    */
+    int load(int layer, LweSample** values, const int count, const size_t size) const;
+};
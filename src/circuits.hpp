@@ -0,0 +1,982 @@
+/**
+    * Arithmetic and comparison circuits, templated over a gate backend.
+    * The same circuit runs on TFHE ciphertexts (TfheBackend, bootstrap.hpp), on plaintext bits (PlainBackend,
+    * microseconds per operation, to check circuit changes against integer references) or on a symbolic counter
+    * (CountBackend, gives the number of bootstraps and the critical path depth without evaluating anything).
+    *
+    * A backend defines a Bit type and
+      Bit* alloc(size_t n) / void release(Bit* x, size_t n)       arrays of n bits
+      void gates(Bit** r, const GateOp* ops, const Bit* const* a, const Bit* const* b, int count)
+                                                                   count independent bootstrapped gates, as one batch
+      void mux(Bit** r, const Bit* const* s, const Bit* const* a, const Bit* const* b, int count)
+      void NOT(Bit* r, const Bit* a), COPY(Bit* r, const Bit* a), CONSTANT(Bit* r, int v)   free gates
+    * Outputs may alias inputs. Numbers are little-endian bit arrays, as in alu.cpp
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum GateOp {GATE_AND, GATE_OR, GATE_NAND, GATE_NOR, GATE_XOR, GATE_XNOR, GATE_ANDNY, GATE_ANDYN, GATE_ORNY, GATE_ORYN};
+
+inline bool evalGate(const GateOp op, const bool a, const bool b) {
+  switch(op) {
+    case GATE_AND: return a && b;
+    case GATE_OR: return a || b;
+    case GATE_NAND: return !(a && b);
+    case GATE_NOR: return !(a || b);
+    case GATE_XOR: return a != b;
+    case GATE_XNOR: return a == b;
+    case GATE_ANDNY: return !a && b;
+    case GATE_ANDYN: return a && !b;
+    case GATE_ORNY: return !a || b;
+    case GATE_ORYN: return a || !b;
+  }
+  return false;
+}
+
+/**
+Constant folding of gates on known bits (0 or 1, -1 for unknown): what the gate reduces to without a bootstrap.
+FOLD_A / FOLD_B copy an operand, FOLD_NOT_* negate it; for a MUX (s ? a : b) FOLD_S / FOLD_NOT_S refer to the select
+*/
+enum GateFold {FOLD_NONE, FOLD_ZERO, FOLD_ONE, FOLD_A, FOLD_NOT_A, FOLD_B, FOLD_NOT_B, FOLD_S, FOLD_NOT_S};
+
+inline GateFold foldGate(const GateOp op, const int a, const int b) {
+  if(a >= 0 && b >= 0) return evalGate(op, a, b) ? FOLD_ONE : FOLD_ZERO;
+  if(a < 0 && b < 0) return FOLD_NONE;
+  // one known input: the gate is a constant, a copy or a NOT of the other one
+  const bool f0 = a >= 0 ? evalGate(op, a, false) : evalGate(op, false, b),
+             f1 = a >= 0 ? evalGate(op, a, true) : evalGate(op, true, b);
+  if(f0 == f1) return f0 ? FOLD_ONE : FOLD_ZERO;
+  if(a >= 0) return f1 ? FOLD_B : FOLD_NOT_B;
+  return f1 ? FOLD_A : FOLD_NOT_A;
+}
+
+inline GateFold foldMux(const int s, const int a, const int b) {
+  if(s >= 0) return s ? FOLD_A : FOLD_B;
+  if(a < 0 || b < 0) return FOLD_NONE;
+  if(a == b) return a ? FOLD_ONE : FOLD_ZERO;
+  return a ? FOLD_S : FOLD_NOT_S;
+}
+
+/** Plaintext bits */
+struct PlainBackend {
+  typedef bool Bit;
+
+  Bit* alloc(size_t n) { return new bool[n](); }
+  void release(Bit* x, size_t) { delete[] x; }
+
+  void gates(Bit** r, const GateOp* ops, const Bit* const* a, const Bit* const* b, int count) {
+    // evaluate everything before writing, outputs may alias inputs
+    std::vector<bool> v(count);
+    for(int k = 0; k < count; k++) v[k] = evalGate(ops[k], *a[k], *b[k]);
+    for(int k = 0; k < count; k++) *r[k] = v[k];
+  }
+  void mux(Bit** r, const Bit* const* s, const Bit* const* a, const Bit* const* b, int count) {
+    std::vector<bool> v(count);
+    for(int k = 0; k < count; k++) v[k] = *s[k] ? *a[k] : *b[k];
+    for(int k = 0; k < count; k++) *r[k] = v[k];
+  }
+  void NOT(Bit* r, const Bit* a) { *r = !*a; }
+  void COPY(Bit* r, const Bit* a) { *r = *a; }
+  void CONSTANT(Bit* r, int v) { *r = v & 1; }
+};
+
+/**
+Symbolic gate counter. A bit carries the number of bootstrapping levels it sits behind; depth is the largest one seen.
+MUX costs two blind rotations (bootsMUX), at one level. batches counts gates() / mux() calls, i.e. sequential rounds.
+Bits also carry their value when it is known (CONSTANT and what folds from it), and gates are folded as in
+bootstrap.cpp, so the counts are those of TfheBackend.
+Not thread safe
+*/
+struct CountDepth {
+  int depth;
+  int value;  // -1 unknown
+
+  CountDepth() : depth(0), value(-1) {}
+};
+
+struct CountBackend {
+  typedef CountDepth Bit;
+  long bootstraps;
+  long batches;
+  int depth;
+
+  CountBackend() : bootstraps(0), batches(0), depth(0) {}
+  void reset() { bootstraps = 0; batches = 0; depth = 0; }
+
+  Bit* alloc(size_t n) { return new CountDepth[n](); }
+  void release(Bit* x, size_t) { delete[] x; }
+
+  void gates(Bit** r, const GateOp* ops, const Bit* const* a, const Bit* const* b, int count) {
+    std::vector<CountDepth> v(count);
+    long rotations = 0;
+    for(int k = 0; k < count; k++) {
+      const GateFold f = foldGate(ops[k], a[k]->value, b[k]->value);
+      if(f == FOLD_NONE) {
+        v[k].depth = std::max(a[k]->depth, b[k]->depth) + 1;
+        rotations++;
+      }
+      else v[k] = folded(f, NULL, a[k], b[k]);
+    }
+    for(int k = 0; k < count; k++) record(r[k], v[k]);
+    bootstraps += rotations;
+    batches += rotations > 0;
+  }
+  void mux(Bit** r, const Bit* const* s, const Bit* const* a, const Bit* const* b, int count) {
+    std::vector<CountDepth> v(count);
+    long rotations = 0;
+    for(int k = 0; k < count; k++) {
+      const GateFold f = foldMux(s[k]->value, a[k]->value, b[k]->value);
+      if(f == FOLD_NONE) {
+        v[k].depth = std::max(s[k]->depth, std::max(a[k]->depth, b[k]->depth)) + 1;
+        // a half AND(s, a) / AND(not(s), b) on a known 0 is not rotated
+        rotations += (a[k]->value != 0) + (b[k]->value != 0);
+      }
+      else v[k] = folded(f, s[k], a[k], b[k]);
+    }
+    for(int k = 0; k < count; k++) record(r[k], v[k]);
+    bootstraps += rotations;
+    batches += rotations > 0;
+  }
+  void NOT(Bit* r, const Bit* a) { r->depth = a->depth; r->value = a->value < 0 ? -1 : !a->value; }
+  void COPY(Bit* r, const Bit* a) { *r = *a; }
+  void CONSTANT(Bit* r, int v) { r->depth = 0; r->value = v & 1; }
+
+  private:
+    void record(Bit* r, const CountDepth& v) {
+      *r = v;
+      depth = std::max(depth, v.depth);
+    }
+    static CountDepth folded(const GateFold f, const Bit* s, const Bit* a, const Bit* b) {
+      CountDepth v;
+      switch(f) {
+        case FOLD_ZERO: v.value = 0; break;
+        case FOLD_ONE: v.value = 1; break;
+        case FOLD_A: v = *a; break;
+        case FOLD_B: v = *b; break;
+        case FOLD_S: v = *s; break;
+        case FOLD_NOT_A: v = *a; v.value = v.value < 0 ? -1 : !v.value; break;
+        case FOLD_NOT_B: v = *b; v.value = v.value < 0 ? -1 : !v.value; break;
+        case FOLD_NOT_S: v = *s; v.value = v.value < 0 ? -1 : !v.value; break;
+        case FOLD_NONE: break;
+      }
+      return v;
+    }
+};
+
+namespace circuit {
+
+template<class B>
+void gate(B& be, const GateOp op, typename B::Bit* r, const typename B::Bit* a, const typename B::Bit* b) {
+  be.gates(&r, &op, &a, &b, 1);
+}
+
+/** r[i] = op(a[i], b[i]) for n bits, one batch */
+template<class B>
+void gate_array(B& be, const GateOp op, typename B::Bit* r, const typename B::Bit* a, const typename B::Bit* b, const size_t n) {
+  std::vector<typename B::Bit*> rp(n);
+  std::vector<const typename B::Bit*> ap(n), bp(n);
+  std::vector<GateOp> ops(n, op);
+  for(size_t i = 0; i < n; i++) { rp[i] = &r[i]; ap[i] = &a[i]; bp[i] = &b[i]; }
+  be.gates(rp.data(), ops.data(), ap.data(), bp.data(), n);
+}
+
+template<class B>
+void copy(B& be, typename B::Bit* r, const typename B::Bit* a, const size_t n) {
+  for(size_t i = 0; i < n; i++) be.COPY(&r[i], &a[i]);
+}
+
+template<class B>
+void NOT(B& be, typename B::Bit* r, const typename B::Bit* a, const size_t n) {
+  for(size_t i = 0; i < n; i++) be.NOT(&r[i], &a[i]);
+}
+
+template<class B>
+void constant(B& be, typename B::Bit* r, const long value, const size_t n) {
+  for(size_t i = 0; i < n; i++) be.CONSTANT(&r[i], (value >> std::min<size_t>(i, 8*sizeof(long)-1)) & 1);
+}
+
+/** Zero fill, as leftShift in alu.cpp */
+template<class B>
+void leftShift(B& be, typename B::Bit* r, const typename B::Bit* a, const size_t size, const int amnt) {
+  for(int i = (int) size-1; i >= amnt; i--) be.COPY(&r[i], &a[i-amnt]);
+  for(int i = 0; i < std::min<int>(amnt, size); i++) be.CONSTANT(&r[i], 0);
+}
+
+/** Zero fill of the top bits, as rightShift in alu.cpp */
+template<class B>
+void rightShift(B& be, typename B::Bit* r, const typename B::Bit* a, const size_t size, const int amnt) {
+  for(int i = 0; i + amnt < (int) size; i++) be.COPY(&r[i], &a[i+amnt]);
+  for(int i = std::max<int>((int) size-amnt, 0); i < (int) size; i++) be.CONSTANT(&r[i], 0);
+}
+
+/**
+Ripple-carry adder: sum = a + b + cin, carry_out = carry out of the MSB.
+cin is the bit carry_in, or the constant cin_const when carry_in is NULL.
+sum and carry_out may be NULL; the gates that only feed a NULL output are skipped.
+The propagate (a XOR b) and generate (a AND b) bits do not depend on the carry, so they are one batch. Along the
+chain, the sum bit and the carry term of each position are a batch of two
+*/
+template<class B>
+void adder(B& be, typename B::Bit* sum, typename B::Bit* carry_out, const typename B::Bit* a, const typename B::Bit* b,
+           const typename B::Bit* carry_in, const int cin_const, const size_t size) {
+  typedef typename B::Bit Bit;
+  if(size == 0) return;
+  Bit *carry = be.alloc(1), *tmp_c = be.alloc(1), *pg = be.alloc(2*size);
+  Bit *prop = pg, *gen = pg + size;
+
+  {
+    std::vector<Bit*> r(2*size);
+    std::vector<const Bit*> x(2*size), y(2*size);
+    std::vector<GateOp> ops(2*size);
+    for(size_t i = 0; i < size; i++) {
+      r[i] = &prop[i]; ops[i] = GATE_XOR;
+      r[size+i] = &gen[i]; ops[size+i] = GATE_AND;
+      x[i] = x[size+i] = &a[i];
+      y[i] = y[size+i] = &b[i];
+    }
+    be.gates(r.data(), ops.data(), x.data(), y.data(), 2*size);
+  }
+
+  // first iteration
+  size_t start = 1;
+  if(carry_in != NULL) {
+    be.COPY(carry, carry_in);
+    start = 0;
+  }
+  else if(cin_const) {
+    // s_0 = NOT(a_0 XOR b_0), c_1 = a_0 OR b_0
+    if(size > 1 || carry_out != NULL)
+      gate(be, GATE_OR, carry, &gen[0], &prop[0]);
+    if(sum != NULL)
+      be.NOT(&sum[0], &prop[0]);
+  }
+  else {
+    if(sum != NULL)
+      be.COPY(&sum[0], &prop[0]);
+    be.COPY(carry, &gen[0]);
+  }
+
+  for(size_t i = start; i < size; i++) {
+    // the carry out of the MSB is only needed by add_with_carry and friends
+    if(i == size-1 && carry_out == NULL) {
+      if(sum != NULL)
+        gate(be, GATE_XOR, &sum[i], &prop[i], carry);
+      break;
+    }
+    if(sum != NULL) {
+      Bit *r[2] = {&sum[i], tmp_c};
+      const Bit *x[2] = {&prop[i], carry}, *y[2] = {carry, &prop[i]};
+      const GateOp ops[2] = {GATE_XOR, GATE_AND};
+      be.gates(r, ops, x, y, 2);
+    }
+    else {
+      gate(be, GATE_AND, tmp_c, carry, &prop[i]);
+    }
+    gate(be, GATE_OR, carry, tmp_c, &gen[i]);
+  }
+  if(carry_out != NULL)
+    be.COPY(carry_out, carry);
+
+  be.release(carry, 1);
+  be.release(tmp_c, 1);
+  be.release(pg, 2*size);
+}
+
+template<class B>
+void add(B& be, typename B::Bit* sum, const typename B::Bit* a, const typename B::Bit* b, const size_t size) {
+  adder(be, sum, (typename B::Bit*) NULL, a, b, (const typename B::Bit*) NULL, 0, size);
+}
+
+/** a - b = a + NOT(b) + 1 */
+template<class B>
+void sub(B& be, typename B::Bit* result, const typename B::Bit* a, const typename B::Bit* b, const size_t size) {
+  typename B::Bit *c = be.alloc(size);
+  NOT(be, c, b, size);
+  adder(be, result, (typename B::Bit*) NULL, a, c, (const typename B::Bit*) NULL, 1, size);
+  be.release(c, size);
+}
+
+/**
+result[k] = (a[k] < b[k]) for count pairs: the borrow out of a - b, only the carry chain is evaluated. Signed inputs
+get their MSBs flipped first (free), which maps two's complement order onto unsigned order.
+The carry chains of all pairs advance together, one batch per gate level
+*/
+template<class B>
+void lessThan_batch(B& be, typename B::Bit* const* result, const typename B::Bit* const* a, const typename B::Bit* const* b, const int count,
+                    const size_t size, const bool is_signed=true) {
+  typedef typename B::Bit Bit;
+  if(count <= 0 || size == 0) return;
+  // x = a, y = NOT(b): a < b iff a + NOT(b) + 1 has no carry out
+  Bit *y = be.alloc(count*size), *pg = be.alloc(2*count*size), *tmp_c = be.alloc(count);
+  Bit *prop = pg, *gen = pg + count*size;
+  std::vector<Bit*> r(2*count*size);
+  std::vector<const Bit*> x(2*count*size), z(2*count*size);
+  std::vector<GateOp> ops(2*count*size);
+  for(int k = 0; k < count; k++) {
+    Bit *yk = &y[k*size];
+    NOT(be, yk, b[k], size);
+    if(is_signed) be.NOT(&yk[size-1], &yk[size-1]);
+  }
+  // prop = x XOR y, gen = x AND y. With the flipped MSB, XOR is unchanged and AND becomes ANDNY
+  for(int k = 0; k < count; k++) {
+    for(size_t i = 0; i < size; i++) {
+      const size_t q = k*size + i;
+      const bool flip = is_signed && i == size-1;
+      r[q] = &prop[q]; ops[q] = flip ? GATE_XNOR : GATE_XOR;
+      r[count*size + q] = &gen[q]; ops[count*size + q] = flip ? GATE_ANDNY : GATE_AND;
+      x[q] = x[count*size + q] = &a[k][i];
+      z[q] = z[count*size + q] = &y[q];
+    }
+  }
+  be.gates(r.data(), ops.data(), x.data(), z.data(), 2*count*size);
+
+  // carry in is 1: c_1 = x_0 OR y_0
+  for(int k = 0; k < count; k++) {
+    r[k] = result[k]; ops[k] = GATE_OR; x[k] = &gen[k*size]; z[k] = &prop[k*size];
+  }
+  be.gates(r.data(), ops.data(), x.data(), z.data(), count);
+  for(size_t i = 1; i < size; i++) {
+    for(int k = 0; k < count; k++) {
+      r[k] = &tmp_c[k]; ops[k] = GATE_AND; x[k] = result[k]; z[k] = &prop[k*size + i];
+    }
+    be.gates(r.data(), ops.data(), x.data(), z.data(), count);
+    for(int k = 0; k < count; k++) {
+      r[k] = result[k]; ops[k] = GATE_OR; x[k] = &tmp_c[k]; z[k] = &gen[k*size + i];
+    }
+    be.gates(r.data(), ops.data(), x.data(), z.data(), count);
+  }
+  for(int k = 0; k < count; k++) be.NOT(result[k], result[k]);
+
+  be.release(y, count*size);
+  be.release(pg, 2*count*size);
+  be.release(tmp_c, count);
+}
+
+template<class B>
+void lessThan(B& be, typename B::Bit* result, const typename B::Bit* a, const typename B::Bit* b, const size_t size, const bool is_signed=true) {
+  lessThan_batch(be, &result, &a, &b, 1, size, is_signed);
+}
+
+/** NOT(a) + 1 as an incrementer */
+template<class B>
+void twosComplement(B& be, typename B::Bit* result, const typename B::Bit* a, const size_t size) {
+  typedef typename B::Bit Bit;
+  if(size == 0) return;
+  Bit *carry = be.alloc(1), *tmp_c = be.alloc(1), *c = be.alloc(size);
+  NOT(be, c, a, size);
+  be.COPY(carry, &c[0]);
+  be.NOT(&result[0], &c[0]);
+  for(size_t i = 1; i < size; i++) {
+    if(i == size-1) {
+      gate(be, GATE_XOR, &result[i], &c[i], carry);
+      break;
+    }
+    Bit *r[2] = {&result[i], tmp_c};
+    const Bit *x[2] = {&c[i], &c[i]}, *y[2] = {carry, carry};
+    const GateOp ops[2] = {GATE_XOR, GATE_AND};
+    be.gates(r, ops, x, y, 2);
+    be.COPY(carry, tmp_c);
+  }
+  be.release(carry, 1);
+  be.release(tmp_c, 1);
+  be.release(c, size);
+}
+
+/** result = s ? a : b, bitwise with a single select bit */
+template<class B>
+void select(B& be, typename B::Bit* result, const typename B::Bit* s, const typename B::Bit* a, const typename B::Bit* b, const size_t size) {
+  std::vector<typename B::Bit*> r(size);
+  std::vector<const typename B::Bit*> sp(size, s), ap(size), bp(size);
+  for(size_t i = 0; i < size; i++) { r[i] = &result[i]; ap[i] = &a[i]; bp[i] = &b[i]; }
+  be.mux(r.data(), sp.data(), ap.data(), bp.data(), size);
+}
+
+/**
+Partial products of count products a[k] * b[k], truncated to size bits: p[k*size + i] = (a[k] AND b[k][i]) << i.
+All of them are one batch
+*/
+template<class B>
+void partial_products(B& be, typename B::Bit** p, const typename B::Bit* const* a, const typename B::Bit* const* b, const int count, const size_t size) {
+  std::vector<typename B::Bit*> pp;
+  std::vector<const typename B::Bit*> pa, pb;
+  for(int k = 0; k < count; k++) {
+    for(size_t i = 0; i < size; i++) {
+      for(size_t j = 0; j < i; j++) be.CONSTANT(&p[k*size + i][j], 0);
+      for(size_t j = 0; j < size-i; j++) {
+        pp.push_back(&p[k*size + i][i+j]);
+        pa.push_back(&a[k][j]);
+        pb.push_back(&b[k][i]);
+      }
+    }
+  }
+  std::vector<GateOp> ops(pp.size(), GATE_AND);
+  be.gates(pp.data(), ops.data(), pa.data(), pb.data(), pp.size());
+}
+
+/** Tree sum of num_arrays arrays, same shape as reduce_add in alu.cpp */
+template<class B>
+void reduce_add(B& be, typename B::Bit* result, typename B::Bit* const* arrays, const int num_arrays, const size_t size) {
+  if(num_arrays == 1) {
+    copy(be, result, arrays[0], size);
+    return;
+  }
+  if(num_arrays == 2) {
+    add(be, result, arrays[0], arrays[1], size);
+    return;
+  }
+  const int mid_point = num_arrays / 2;
+  typename B::Bit *result1 = be.alloc(size);
+  reduce_add(be, result, arrays, mid_point, size);
+  reduce_add(be, result1, &arrays[mid_point], num_arrays-mid_point, size);
+  add(be, result, result, result1, size);
+  be.release(result1, size);
+}
+
+/**
+count independent additions sums[k] = as[k] + bs[k] + cin_const, advanced together one bit position at a time
+(wavefront): the propagate and generate bits of all of them are one batch, then at bit i the sum bits and carry terms
+of all additions are one batch of 2 * count gates and the carries one of count. The gates are those of adder, the
+number of batches that of a single addition.
+Bit i of sums[k], as[k] and bs[k] is at index i * stride_s, i * stride_a and i * stride_b: with a stride of the
+element count, the operands are elements of a bit-plane tensor, read and written in place
+*/
+template<class B>
+void adder_batch(B& be, typename B::Bit* const* sums, const typename B::Bit* const* as, const typename B::Bit* const* bs, const int count,
+                 const int cin_const, const size_t size, const size_t stride_s=1, const size_t stride_a=1, const size_t stride_b=1) {
+  typedef typename B::Bit Bit;
+  if(count <= 0 || size == 0) return;
+  Bit *pg = be.alloc(2*count*size), *carry = be.alloc(count), *tmp_c = be.alloc(count);
+  Bit *prop = pg, *gen = pg + count*size;
+  std::vector<Bit*> r(2*count*size);
+  std::vector<const Bit*> x(2*count*size), y(2*count*size);
+  std::vector<GateOp> ops(2*count*size);
+  for(int k = 0; k < count; k++) {
+    for(size_t i = 0; i < size; i++) {
+      const size_t q = k*size + i;
+      r[q] = &prop[q]; ops[q] = GATE_XOR;
+      r[count*size + q] = &gen[q]; ops[count*size + q] = GATE_AND;
+      x[q] = x[count*size + q] = &as[k][i*stride_a];
+      y[q] = y[count*size + q] = &bs[k][i*stride_b];
+    }
+  }
+  be.gates(r.data(), ops.data(), x.data(), y.data(), 2*count*size);
+
+  // first position: s_0 = NOT(p_0), c_1 = g_0 OR p_0 with a carry in, s_0 = p_0, c_1 = g_0 without
+  if(cin_const && size > 1) {
+    for(int k = 0; k < count; k++) {
+      r[k] = &carry[k]; ops[k] = GATE_OR; x[k] = &gen[k*size]; y[k] = &prop[k*size];
+    }
+    be.gates(r.data(), ops.data(), x.data(), y.data(), count);
+  }
+  for(int k = 0; k < count; k++) {
+    if(cin_const) be.NOT(&sums[k][0], &prop[k*size]);
+    else {
+      be.COPY(&sums[k][0], &prop[k*size]);
+      be.COPY(&carry[k], &gen[k*size]);
+    }
+  }
+
+  for(size_t i = 1; i < size; i++) {
+    // the MSB needs no carry out
+    const bool last = i == size-1;
+    for(int k = 0; k < count; k++) {
+      r[k] = &sums[k][i*stride_s]; ops[k] = GATE_XOR; x[k] = &prop[k*size + i]; y[k] = &carry[k];
+      r[count + k] = &tmp_c[k]; ops[count + k] = GATE_AND; x[count + k] = &carry[k]; y[count + k] = &prop[k*size + i];
+    }
+    be.gates(r.data(), ops.data(), x.data(), y.data(), last ? count : 2*count);
+    if(last) break;
+    for(int k = 0; k < count; k++) {
+      r[k] = &carry[k]; ops[k] = GATE_OR; x[k] = &tmp_c[k]; y[k] = &gen[k*size + i];
+    }
+    be.gates(r.data(), ops.data(), x.data(), y.data(), count);
+  }
+
+  be.release(pg, 2*count*size);
+  be.release(carry, count);
+  be.release(tmp_c, count);
+}
+
+/** sums[k] = as[k] + bs[k] for count pairs, as one wavefront. The strides are those of adder_batch */
+template<class B>
+void add_batch(B& be, typename B::Bit* const* sums, const typename B::Bit* const* as, const typename B::Bit* const* bs, const int count, const size_t size,
+               const size_t stride_s=1, const size_t stride_a=1, const size_t stride_b=1) {
+  adder_batch(be, sums, as, bs, count, 0, size, stride_s, stride_a, stride_b);
+}
+
+/** results[k] = as[k] - bs[k] = as[k] + NOT(bs[k]) + 1 for count pairs, as one wavefront */
+template<class B>
+void sub_batch(B& be, typename B::Bit* const* results, const typename B::Bit* const* as, const typename B::Bit* const* bs, const int count, const size_t size) {
+  typedef typename B::Bit Bit;
+  Bit *c = be.alloc(count*size);
+  std::vector<const Bit*> cp(count);
+  for(int k = 0; k < count; k++) {
+    NOT(be, &c[k*size], bs[k], size);
+    cp[k] = &c[k*size];
+  }
+  adder_batch(be, results, as, cp.data(), count, 1, size);
+  be.release(c, count*size);
+}
+
+/**
+results[k] = sum of the num_arrays[k] arrays of arrays[k], for count groups (0 for an empty group). The groups are
+summed as pairwise trees, level by level: every level is one add_batch over all the pairs of all the groups
+*/
+template<class B>
+void reduce_add_batch(B& be, typename B::Bit* const* results, typename B::Bit* const* const* arrays, const int* num_arrays, const int count,
+                      const size_t size) {
+  typedef typename B::Bit Bit;
+  std::vector<std::vector<const Bit*> > level(count);
+  for(int k = 0; k < count; k++) {
+    level[k].assign(arrays[k], arrays[k] + num_arrays[k]);
+  }
+  std::vector<Bit*> temps;
+  while(true) {
+    std::vector<Bit*> r;
+    std::vector<const Bit*> x, y;
+    for(int k = 0; k < count; k++) {
+      for(size_t j = 0; j + 1 < level[k].size(); j += 2) {
+        temps.push_back(be.alloc(size));
+        r.push_back(temps.back());
+        x.push_back(level[k][j]);
+        y.push_back(level[k][j+1]);
+      }
+    }
+    if(r.empty()) break;
+    add_batch(be, r.data(), x.data(), y.data(), r.size(), size);
+    // the next level: the pair sums in order, then the odd one out
+    size_t q = 0;
+    for(int k = 0; k < count; k++) {
+      std::vector<const Bit*> next;
+      for(size_t j = 0; j + 1 < level[k].size(); j += 2) next.push_back(r[q++]);
+      if(level[k].size() % 2) next.push_back(level[k].back());
+      level[k].swap(next);
+    }
+  }
+  for(int k = 0; k < count; k++) {
+    if(level[k].empty()) constant(be, results[k], 0, size);
+    else copy(be, results[k], level[k][0], size);
+  }
+  for(size_t q = 0; q < temps.size(); q++) be.release(temps[q], size);
+}
+
+template<class B>
+void mult_batch(B& be, typename B::Bit** result, const typename B::Bit* const* a, const typename B::Bit* const* b, const int count, const size_t size) {
+  std::vector<typename B::Bit*> p(count*size);
+  for(size_t q = 0; q < p.size(); q++) p[q] = be.alloc(size);
+  partial_products(be, p.data(), a, b, count, size);
+  for(int k = 0; k < count; k++) {
+    reduce_add(be, result[k], &p[k*size], size, size);
+  }
+  for(size_t q = 0; q < p.size(); q++) be.release(p[q], size);
+}
+
+template<class B>
+void mult(B& be, typename B::Bit* result, const typename B::Bit* a, const typename B::Bit* b, const size_t size) {
+  mult_batch(be, &result, &a, &b, 1, size);
+}
+
+/*
+Guard columns kept below the fraction bits by the truncated fixed-point multiplier. The dropped columns are replaced
+by their expected value, whose error is below 3/4 * lo / 2^guard units: with ceil(log2(size)) + 1 guard columns the
+result is within one unit of round(a * b / 2^frac_bits)
+*/
+inline int mult_fixed_guard(const size_t size) {
+  int guard = 1;
+  while((1u << (guard - 1)) < size) guard++;
+  return guard;
+}
+
+/**
+Rows of the windowed fixed-point product of count pairs. The signed size x size product is written Baugh-Wooley
+style: bit (i, j) is a_i AND b_j, or NAND when exactly one of i, j is the sign position, plus the constant
+2^size + 2^(2 size - 1). Only the columns lo = frac_bits - guard .. frac_bits + size - 1 feed the result, so only the
+bits in that window are generated (one batch for all pairs). Row r of product k is rows[k * rows_per + r], w = size +
+frac_bits - lo bits wide, and the last row is the constant: rounding 2^(frac_bits-1), the Baugh-Wooley constant and
+the expected value of the dropped columns. Returns rows_per; the caller sums the rows of a product and keeps the
+top size bits
+*/
+template<class B>
+int fixed_partial_products(B& be, std::vector<typename B::Bit*>& rows, size_t& w, const typename B::Bit* const* a, const typename B::Bit* const* b,
+                           const int count, const size_t size, const int frac_bits, int guard=-1) {
+  if(guard < 0) guard = mult_fixed_guard(size);
+  const int n = size, lo = std::max(0, frac_bits - guard), hi = frac_bits + n;
+  w = hi - lo;
+  // rows j whose columns j .. j+n-1 all fall below the window are empty
+  const int first = std::max(0, lo - (n - 1)), rows_per = n - first + 1;
+  rows.resize(count * rows_per);
+  for(size_t q = 0; q < rows.size(); q++) {
+    rows[q] = be.alloc(w);
+    constant(be, rows[q], 0, w);
+  }
+
+  std::vector<typename B::Bit*> r;
+  std::vector<const typename B::Bit*> x, y;
+  std::vector<GateOp> ops;
+  for(int k = 0; k < count; k++) {
+    for(int j = first; j < n; j++) {
+      for(int i = std::max(0, lo - j); i < n && i + j < hi; i++) {
+        r.push_back(&rows[k*rows_per + j - first][i + j - lo]);
+        x.push_back(&a[k][i]);
+        y.push_back(&b[k][j]);
+        ops.push_back((i == n-1) != (j == n-1) ? GATE_NAND : GATE_AND);
+      }
+    }
+  }
+  be.gates(r.data(), ops.data(), x.data(), y.data(), r.size());
+
+  // constant row, in units of 2^lo modulo 2^w
+  double dropped = 0;
+  for(int j = 0; j < n; j++) {
+    for(int i = 0; i < n && i + j < lo; i++) {
+      dropped += ldexp((i == n-1) != (j == n-1) ? 0.75 : 0.25, i + j - lo);
+    }
+  }
+  uint64_t c = (uint64_t) llround(dropped);
+  if(frac_bits > 0) c += UINT64_C(1) << (frac_bits - 1 - lo);
+  if(n - lo < (int) w) c += UINT64_C(1) << (n - lo);
+  if(2*n - 1 - lo < (int) w) c += UINT64_C(1) << (2*n - 1 - lo);
+  for(int k = 0; k < count; k++) {
+    typename B::Bit *row = rows[k*rows_per + rows_per - 1];
+    for(size_t t = 0; t < w; t++) be.CONSTANT(&row[t], (c >> t) & 1);
+  }
+  return rows_per;
+}
+
+/**
+result[k] = a[k] * b[k] / 2^frac_bits, rounded, for fixed-point values with frac_bits fraction bits: the product
+comes back at the scale of its inputs, modulo 2^size. Truncated multiplier, see fixed_partial_products.
+frac_bits = 0 is the integer mult
+*/
+template<class B>
+void mult_fixed_batch(B& be, typename B::Bit** result, const typename B::Bit* const* a, const typename B::Bit* const* b, const int count,
+                      const size_t size, const int frac_bits, int guard=-1) {
+  if(guard < 0) guard = mult_fixed_guard(size);
+  std::vector<typename B::Bit*> rows;
+  size_t w;
+  const int rows_per = fixed_partial_products(be, rows, w, a, b, count, size, frac_bits, guard);
+  const int shift = frac_bits - std::max(0, frac_bits - guard);
+  // the count sums as one reduce_add_batch wavefront, then the size-bit window of each
+  typename B::Bit *sums = be.alloc(count*w);
+  std::vector<typename B::Bit*> sum_ptr(count);
+  std::vector<typename B::Bit**> groups(count);
+  std::vector<int> nums(count, rows_per);
+  for(int k = 0; k < count; k++) {
+    sum_ptr[k] = &sums[k*w];
+    groups[k] = &rows[k*rows_per];
+  }
+  reduce_add_batch(be, sum_ptr.data(), groups.data(), nums.data(), count, w);
+  for(int k = 0; k < count; k++) copy(be, result[k], &sum_ptr[k][shift], size);
+  be.release(sums, count*w);
+  for(size_t q = 0; q < rows.size(); q++) be.release(rows[q], w);
+}
+
+template<class B>
+void mult_fixed(B& be, typename B::Bit* result, const typename B::Bit* a, const typename B::Bit* b, const size_t size, const int frac_bits) {
+  mult_fixed_batch(be, &result, &a, &b, 1, size, frac_bits);
+}
+
+/** sum of a[j] shifted by b[j] (right for negative b[j]), accumulated sequentially as shiftDot in matrix.cpp */
+template<class B>
+void shiftDot(B& be, typename B::Bit* result, typename B::Bit* const* a, const int* b, const int cols, const size_t size) {
+  typename B::Bit *term = be.alloc(size);
+  constant(be, result, 0, size);
+  for(int j = 0; j < cols; j++) {
+    if(b[j] < 0) rightShift(be, term, a[j], size, -b[j]);
+    else leftShift(be, term, a[j], size, b[j]);
+    add(be, result, result, term, size);
+  }
+  be.release(term, size);
+}
+
+/**
+Fixed point plaintext weights times an encrypted vector, for many rows at once. As in the plaintext mat_mult, the
+weights are taken apart into the bit planes of their magnitudes, but the planes are summed before they are shifted:
+D_rj, the signed sum of the inputs whose weight in row r has bit j set, is shifted by j - frac_bits (arithmetically,
+so products keep frac_bits fraction bits) and out[r] is the sum of the shifted planes, plus bias[r] (bias may be
+NULL). Same result as ref_matVec.
+The inputs are grouped in blocks of MATVEC_BLOCK, and the subset sums of a block are computed once, for all rows and
+planes: a D_rj is then one add per block instead of one per input. Only the subset sums some D_rj uses are built,
+in waves of independent adds (a subset of p inputs is the subset without its last input, plus that input). Every
+wave, all D_rj, and the sums of all rows are each one wavefront of additions (add_batch, reduce_add_batch)
+*/
+#define MATVEC_BLOCK 4
+
+template<class B>
+void matVec(B& be, typename B::Bit* const* out, const int* weights, const int* bias, typename B::Bit* const* x, const int rows, const int cols,
+            const int frac_bits, const size_t size) {
+  typedef typename B::Bit Bit;
+  const int planes = size, blocks = (cols + MATVEC_BLOCK - 1) / MATVEC_BLOCK, subsets = 1 << MATVEC_BLOCK;
+  // input masks of D_rj per block, positive and negative weights: mask[(r * planes + j) * blocks + b]
+  std::vector<int> pos_mask(rows * planes * blocks, 0), neg_mask(rows * planes * blocks, 0);
+  std::vector<bool> needed(blocks * subsets, false);
+  for(int r = 0; r < rows; r++) {
+    for(int i = 0; i < cols; i++) {
+      const int w = weights[r * cols + i];
+      const unsigned int mag = w < 0 ? -(unsigned int) w : w;
+      for(int j = 0; j < planes; j++) {
+        if(!((mag >> j) & 1)) continue;
+        (w < 0 ? neg_mask : pos_mask)[(r * planes + j) * blocks + i / MATVEC_BLOCK] |= 1 << (i % MATVEC_BLOCK);
+      }
+    }
+  }
+  // the subsets used, and their prefixes
+  for(size_t q = 0; q < pos_mask.size(); q++) {
+    const int b = q % blocks;
+    if(pos_mask[q]) needed[b * subsets + pos_mask[q]] = true;
+    if(neg_mask[q]) needed[b * subsets + neg_mask[q]] = true;
+  }
+  std::vector<Bit*> sums(blocks * subsets, (Bit*) NULL);
+  for(int b = 0; b < blocks; b++) {
+    for(int mask = subsets - 1; mask > 0; mask--) {
+      const int high = 31 - __builtin_clz(mask);
+      if(needed[b * subsets + mask] && mask != 1 << high) needed[b * subsets + (mask ^ 1 << high)] = true;
+    }
+    for(int t = 0; t < MATVEC_BLOCK && b * MATVEC_BLOCK + t < cols; t++) {
+      sums[b * subsets + (1 << t)] = x[b * MATVEC_BLOCK + t];
+    }
+  }
+  for(int p = 2; p <= MATVEC_BLOCK; p++) {
+    std::vector<Bit*> r;
+    std::vector<const Bit*> a, c;
+    for(int q = 0; q < blocks * subsets; q++) {
+      const int mask = q % subsets;
+      if(!needed[q] || __builtin_popcount(mask) != p) continue;
+      const int high = 31 - __builtin_clz(mask);
+      sums[q] = be.alloc(size);
+      r.push_back(sums[q]);
+      a.push_back(sums[q - mask + (mask ^ 1 << high)]);
+      c.push_back(sums[q - mask + (1 << high)]);
+    }
+    add_batch(be, r.data(), a.data(), c.data(), r.size(), size);
+  }
+
+  // D_rj of the planes some weight uses: positive sums, then the negative ones of the D_rj that have any
+  std::vector<int> used;
+  for(int q = 0; q < rows * planes; q++) {
+    for(int b = 0; b < blocks; b++) {
+      if(pos_mask[q * blocks + b] || neg_mask[q * blocks + b]) {
+        used.push_back(q);
+        break;
+      }
+    }
+  }
+  std::vector<std::vector<Bit*>> pos(used.size()), neg(used.size());
+  std::vector<Bit*> d(used.size()), neg_d, neg_sums;
+  std::vector<Bit* const*> groups;
+  std::vector<int> nums;
+  for(size_t k = 0; k < used.size(); k++) {
+    const int q = used[k];
+    for(int b = 0; b < blocks; b++) {
+      if(pos_mask[q * blocks + b]) pos[k].push_back(sums[b * subsets + pos_mask[q * blocks + b]]);
+      if(neg_mask[q * blocks + b]) neg[k].push_back(sums[b * subsets + neg_mask[q * blocks + b]]);
+    }
+    d[k] = be.alloc(size);
+    groups.push_back(pos[k].data());
+    nums.push_back(pos[k].size());
+  }
+  for(size_t k = 0; k < used.size(); k++) {
+    if(neg[k].empty()) continue;
+    d.push_back(be.alloc(size));
+    groups.push_back(neg[k].data());
+    nums.push_back(neg[k].size());
+    neg_d.push_back(d[k]);
+    neg_sums.push_back(d.back());
+  }
+  reduce_add_batch(be, d.data(), groups.data(), nums.data(), d.size(), size);
+  sub_batch(be, neg_d.data(), neg_d.data(), neg_sums.data(), neg_d.size(), size);
+
+  // shifted into fixed point terms
+  std::vector<Bit*> terms(rows * planes, (Bit*) NULL);
+  for(size_t k = 0; k < used.size(); k++) {
+    const int q = used[k], shift = q % planes - frac_bits;
+    Bit *term = terms[q] = be.alloc(size);
+    for(int t = 0; t < (int) size; t++) {
+      const int from = std::min(t - shift, (int) size - 1);
+      if(from < 0) be.CONSTANT(&term[t], 0);
+      else be.COPY(&term[t], &d[k][from]);
+    }
+  }
+  for(size_t k = 0; k < d.size(); k++) be.release(d[k], size);
+
+  // out[r] is the sum of its planes and the bias, all rows together
+  std::vector<std::vector<Bit*>> row(rows);
+  std::vector<Bit*> biases;
+  groups.clear();
+  nums.clear();
+  for(int r = 0; r < rows; r++) {
+    for(int j = 0; j < planes; j++) {
+      if(terms[r * planes + j] != NULL) row[r].push_back(terms[r * planes + j]);
+    }
+    if(bias != NULL && bias[r] != 0) {
+      biases.push_back(be.alloc(size));
+      constant(be, biases.back(), bias[r], size);
+      row[r].push_back(biases.back());
+    }
+    groups.push_back(row[r].data());
+    nums.push_back(row[r].size());
+  }
+  reduce_add_batch(be, out, groups.data(), nums.data(), rows, size);
+
+  for(size_t k = 0; k < biases.size(); k++) be.release(biases[k], size);
+  for(size_t q = 0; q < terms.size(); q++) {
+    if(terms[q] != NULL) be.release(terms[q], size);
+  }
+  for(int q = 0; q < blocks * subsets; q++) {
+    if(sums[q] != NULL && __builtin_popcount(q % subsets) > 1) be.release(sums[q], size);
+  }
+}
+
+/**
+Compare-exchange of records (value in the low size bits, then the index bits): for each pair (i[k], j[k]), record
+i[k] ends up with the larger value when desc[k] (the smaller one otherwise) and record j[k] with the other one.
+With keep_both false, only record i[k] is written. All comparisons are one lessThan_batch, all selections one mux batch.
+Records are replaced by newly allocated ones
+*/
+template<class B>
+void compare_exchange(B& be, std::vector<typename B::Bit*>& records, const std::vector<int>& i, const std::vector<int>& j, const std::vector<bool>& desc,
+                      const bool keep_both, const size_t width, const size_t size, const bool is_signed) {
+  typedef typename B::Bit Bit;
+  const int count = i.size();
+  if(count == 0) return;
+  Bit *s = be.alloc(count);
+  std::vector<Bit*> sp(count);
+  std::vector<const Bit*> x(count), y(count);
+  for(int k = 0; k < count; k++) { sp[k] = &s[k]; x[k] = records[i[k]]; y[k] = records[j[k]]; }
+  // s = record i < record j
+  lessThan_batch(be, sp.data(), x.data(), y.data(), count, size, is_signed);
+
+  const int outputs = keep_both ? 2 : 1;
+  std::vector<Bit*> fresh(outputs*count), r;
+  std::vector<const Bit*> sel, hi, lo;
+  for(int k = 0; k < count; k++) {
+    const Bit *larger_if = records[j[k]], *smaller_if = records[i[k]];
+    for(int o = 0; o < outputs; o++) {
+      Bit *out = fresh[o*count + k] = be.alloc(width);
+      // output 0 goes to i: the larger for desc; output 1 goes to j: the other one
+      const bool take_larger = (o == 0) == desc[k];
+      for(size_t t = 0; t < width; t++) {
+        r.push_back(&out[t]);
+        sel.push_back(&s[k]);
+        hi.push_back(take_larger ? &larger_if[t] : &smaller_if[t]);
+        lo.push_back(take_larger ? &smaller_if[t] : &larger_if[t]);
+      }
+    }
+  }
+  be.mux(r.data(), sel.data(), hi.data(), lo.data(), r.size());
+  for(int k = 0; k < count; k++) {
+    be.release(records[i[k]], width);
+    records[i[k]] = fresh[k];
+    if(keep_both) {
+      be.release(records[j[k]], width);
+      records[j[k]] = fresh[count + k];
+    }
+  }
+  be.release(s, count);
+}
+
+/**
+index = position of the largest of count scores (the first one on ties), value = that score; value may be NULL.
+Log-depth tournament: every round compares disjoint pairs together and carries the index bits along through the MUX
+*/
+template<class B>
+void argmax(B& be, typename B::Bit* index, typename B::Bit* value, typename B::Bit* const* scores, const int count, const size_t size,
+            const int index_bits, const bool is_signed=true) {
+  const size_t width = size + index_bits;
+  std::vector<typename B::Bit*> records(count);
+  for(int k = 0; k < count; k++) {
+    records[k] = be.alloc(width);
+    copy(be, records[k], scores[k], size);
+    constant(be, &records[k][size], k, index_bits);
+  }
+  for(int n = count; n > 1; n = (n + 1) / 2) {
+    std::vector<int> i, j;
+    for(int k = 0; k + 1 < n; k += 2) { i.push_back(k); j.push_back(k+1); }
+    compare_exchange(be, records, i, j, std::vector<bool>(i.size(), true), false, width, size, is_signed);
+    // winners move to the front, an odd one out passes through
+    for(int k = 0; k < n / 2; k++) std::swap(records[k], records[2*k]);
+    if(n % 2) std::swap(records[n / 2], records[n - 1]);
+  }
+  copy(be, index, &records[0][size], index_bits);
+  if(value != NULL) copy(be, value, records[0], size);
+  for(int k = 0; k < count; k++) be.release(records[k], width);
+}
+
+/**
+The k largest of count scores in decreasing order: indices[r] and values[r] (values may be NULL) for rank r < k.
+Bitonic partial sorting network: the scores are padded with the minimum value to a power of two, blocks of K (k
+rounded up to a power of two) are bitonic sorted in alternating directions, then each round merges pairs of blocks
+into the top K of both (elementwise max of a decreasing and an increasing block, then a bitonic merge) until one
+block is left. Every stage of compare-exchanges is one batch.
+Records are compared on a size + 1 bit key, the score above a valid bit (1 for the scores, 0 for the padding), so a
+real score at the minimum value beats the padding
+*/
+template<class B>
+void topk(B& be, typename B::Bit* const* indices, typename B::Bit* const* values, typename B::Bit* const* scores, const int count, const int k,
+          const size_t size, const int index_bits, const bool is_signed=true) {
+  const size_t key = size + 1, width = key + index_bits;
+  int K = 1, P = 1;
+  while(K < k) K *= 2;
+  while(P < count || P < K) P *= 2;
+  std::vector<typename B::Bit*> records(P);
+  for(int q = 0; q < P; q++) {
+    records[q] = be.alloc(width);
+    be.CONSTANT(&records[q][0], q < count);
+    if(q < count) copy(be, &records[q][1], scores[q], size);
+    else constant(be, &records[q][1], is_signed ? -(1L << (size-1)) : 0, size);
+    constant(be, &records[q][key], q, index_bits);
+  }
+
+  // block b of K records sorted decreasing for even b, increasing for odd b; a single block decreasing
+  for(int span = 2; span <= K; span *= 2) {
+    for(int stride = span / 2; stride > 0; stride /= 2) {
+      std::vector<int> i, j;
+      std::vector<bool> desc;
+      for(int q = 0; q < P; q++) {
+        const int l = q ^ stride;
+        if(l <= q) continue;
+        const bool block_desc = (q / K) % 2 == 0;
+        // bitonic sort: the sub-sequences of length span alternate direction, the last stage follows the block
+        const bool up = ((q % K) & span) == 0;
+        i.push_back(q); j.push_back(l); desc.push_back(up == block_desc);
+      }
+      compare_exchange(be, records, i, j, desc, true, width, key, is_signed);
+    }
+  }
+
+  for(int blocks = P / K; blocks > 1; blocks /= 2) {
+    // top K of blocks 2t (decreasing) and 2t+1 (increasing): elementwise max, a bitonic sequence
+    std::vector<int> i, j;
+    for(int t = 0; t < blocks / 2; t++) {
+      for(int q = 0; q < K; q++) { i.push_back(2*t*K + q); j.push_back((2*t+1)*K + q); }
+    }
+    compare_exchange(be, records, i, j, std::vector<bool>(i.size(), true), false, width, key, is_signed);
+    for(int t = 0; t < blocks / 2; t++) {
+      for(int q = 0; q < K; q++) std::swap(records[t*K + q], records[2*t*K + q]);
+    }
+    // bitonic merge of the new blocks, decreasing for even t, increasing for odd t
+    for(int stride = K / 2; stride > 0; stride /= 2) {
+      std::vector<int> mi, mj;
+      std::vector<bool> desc;
+      for(int q = 0; q < blocks / 2 * K; q++) {
+        const int l = q ^ stride;
+        if(l <= q) continue;
+        mi.push_back(q); mj.push_back(l); desc.push_back((q / K) % 2 == 0);
+      }
+      compare_exchange(be, records, mi, mj, desc, true, width, key, is_signed);
+    }
+  }
+
+  for(int r = 0; r < k; r++) {
+    copy(be, indices[r], &records[r][key], index_bits);
+    if(values != NULL) copy(be, values[r], &records[r][1], size);
+  }
+  for(int q = 0; q < P; q++) be.release(records[q], width);
+}
+
+}
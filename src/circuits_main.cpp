@@ -0,0 +1,282 @@
+/*
+Checks the circuits of circuits.hpp, and an adder imported from a Bristol file, on plaintext bits against integer
+references, and prints their cost.
+Usage: SHE_circuits [trials] [size]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include "bristol.hpp"
+#include "circuits.hpp"
+#include "reference.hpp"
+
+static void toBits(bool* bits, long value, const int size) {
+  for(int i = 0; i < size; i++) bits[i] = (value >> i) & 1;
+}
+
+/* two's complement value of a size-bit array */
+static long fromBits(const bool* bits, const int size) {
+  long value = 0;
+  for(int i = 0; i < size; i++) value |= (long) bits[i] << i;
+  if(bits[size-1]) value -= 1L << size;
+  return value;
+}
+
+static long fromBitsUnsigned(const bool* bits, const int size) {
+  long value = 0;
+  for(int i = 0; i < size; i++) value |= (long) bits[i] << i;
+  return value;
+}
+
+static long wrap(long value, const int size) {
+  value &= (1L << size) - 1;
+  return value >= (1L << (size-1)) ? value - (1L << size) : value;
+}
+
+static int writeText(const char* path, const std::string& text) {
+  FILE *f = fopen(path, "w");
+  if(f == NULL) return -1;
+  fputs(text.c_str(), f);
+  return fclose(f);
+}
+
+/*
+Ripple-carry adder of size bits in Bristol Fashion, wires LSB first: a, b, internal wires, then the sum.
+The carry in is INV of an EQ 1 wire, so every gate type of the parser is used
+*/
+static int writeBristolAdder(const char* path, const int size) {
+  const int internal = 2 * size, sum = internal + 2 + 4 * size;
+  std::string text = std::to_string(2 + 5 * size) + " " + std::to_string(sum + size) + "\n2 " + std::to_string(size) + " "
+                     + std::to_string(size) + "\n1 " + std::to_string(size) + "\n\n";
+  text += "1 1 1 " + std::to_string(internal) + " EQ\n1 1 " + std::to_string(internal) + " " + std::to_string(internal + 1) + " INV\n";
+  int carry = internal + 1;
+  for(int i = 0; i < size; i++) {
+    const int a = i, b = size + i, t = internal + 2 + 4 * i, g = t + 1, h = t + 2, next = t + 3;
+    const std::string A = std::to_string(a), B = std::to_string(b), T = std::to_string(t), C = std::to_string(carry);
+    text += "2 1 " + A + " " + B + " " + T + " XOR\n";
+    text += "2 1 " + T + " " + C + " " + std::to_string(sum + i) + " XOR\n";
+    text += "2 1 " + A + " " + B + " " + std::to_string(g) + " AND\n";
+    text += "2 1 " + C + " " + T + " " + std::to_string(h) + " AND\n";
+    text += "2 1 " + std::to_string(g) + " " + std::to_string(h) + " " + std::to_string(next) + " XOR\n";
+    carry = next;
+  }
+  return writeText(path, text);
+}
+
+int main(int argc, char** argv) {
+  const long trials = argc > 1 ? atol(argv[1]) : 1000000;
+  const int size = argc > 2 ? atoi(argv[2]) : 16;
+  const int cols = 8;
+  if(size < 2 || size > 32) {
+    printf("Error: size must be in 2..32\n");
+    return 1;
+  }
+
+  PlainBackend be;
+  std::mt19937_64 rng(0);
+  bool a[64], b[64], r[64], lt;
+  bool cols_bits[cols][64];
+  bool *cols_ptr[cols];
+  int shifts[cols];
+  long col_vals[cols];
+  bool batch_bits[cols][64];
+  bool *batch_ptr[cols];
+  for(int j = 0; j < cols; j++) batch_ptr[j] = batch_bits[j];
+  for(int j = 0; j < cols; j++) cols_ptr[j] = cols_bits[j];
+
+  long failures = 0;
+  // Bristol import: an adder evaluated on every trial, and files the parser must reject, all written to one
+  // temporary file
+  char bristol_path[] = "/tmp/SHE_circuits.XXXXXX";
+  const int bristol_fd = mkstemp(bristol_path);
+  if(bristol_fd < 0) {
+    printf("Error: failed to create a temporary file\n");
+    return 1;
+  }
+  close(bristol_fd);
+  BristolCircuit adder;
+  if(writeBristolAdder(bristol_path, size) < 0 || readBristol(adder, bristol_path) < 0) {
+    printf("Error: failed to load the Bristol adder\n");
+    unlink(bristol_path);
+    return 1;
+  }
+  const char *malformed[] = {"1 3\n2 1 1\n1 1\n2 1 0 1 5 AND\n",  // wire out of range
+                             "1 3\n2 1 1\n1 1\n2 1 0 1 2 INV\n",  // arity
+                             "99999999999 3\n2 1 1\n1 1\n2 1 0 1 2 AND\n",  // gate count does not fit
+                             "1 3\n2 1 1\n1 1\n2 1 0 x 2 AND\n"};  // not a number
+  for(const char *text: malformed) {
+    BristolCircuit rejected;
+    if(writeText(bristol_path, text) < 0 || readBristol(rejected, bristol_path) == 0) {
+      failures++; printf("readBristol accepted %s", text);
+    }
+  }
+  unlink(bristol_path);
+  for(long t = 0; t < trials; t++) {
+    const long x = wrap(rng(), size), y = wrap(rng(), size);
+    toBits(a, x, size);
+    toBits(b, y, size);
+
+    circuit::add(be, r, a, b, size);
+    if(fromBits(r, size) != wrap(x + y, size)) { failures++; printf("add(%ld, %ld) = %ld\n", x, y, fromBits(r, size)); }
+    bool *adder_in[2] = {a, b}, *adder_out[1] = {r};
+    evalBristol(be, adder_out, adder_in, adder);
+    if(fromBits(r, size) != wrap(x + y, size)) { failures++; printf("Bristol add(%ld, %ld) = %ld\n", x, y, fromBits(r, size)); }
+    circuit::sub(be, r, a, b, size);
+    if(fromBits(r, size) != wrap(x - y, size)) { failures++; printf("sub(%ld, %ld) = %ld\n", x, y, fromBits(r, size)); }
+    circuit::mult(be, r, a, b, size);
+    if(fromBits(r, size) != wrap(x * y, size)) { failures++; printf("mult(%ld, %ld) = %ld\n", x, y, fromBits(r, size)); }
+    const int frac_bits = rng() % size;
+    circuit::mult_fixed(be, r, a, b, size, frac_bits);
+    const long exact = wrap((x * y + (frac_bits ? 1L << (frac_bits - 1) : 0)) >> frac_bits, size), got = fromBits(r, size);
+    if(got != ref_mult_fixed(x, y, frac_bits, size) || (wrap(got - exact, size) != 0 && wrap(got - exact, size) != 1 && wrap(got - exact, size) != -1)) {
+      failures++; printf("mult_fixed(%ld, %ld, %d) = %ld, rounded %ld\n", x, y, frac_bits, got, exact);
+    }
+    circuit::twosComplement(be, r, a, size);
+    if(fromBits(r, size) != wrap(-x, size)) { failures++; printf("twosComplement(%ld) = %ld\n", x, fromBits(r, size)); }
+    circuit::lessThan(be, &lt, a, b, size);
+    if(lt != (x < y)) { failures++; printf("lessThan(%ld, %ld) = %d\n", x, y, lt); }
+
+    // shiftDot: ShiftDotProduct in SHE.cpp, with the zero-filling right shift of the bit arrays
+    long expected = 0;
+    for(int j = 0; j < cols; j++) {
+      const long v = col_vals[j] = wrap(rng(), size);
+      shifts[j] = (int) (rng() % 7) - 3;
+      toBits(cols_bits[j], v, size);
+      const unsigned long pattern = (unsigned long) v & ((1UL << size) - 1);
+      expected = wrap(expected + (shifts[j] < 0 ? (long) (pattern >> -shifts[j]) : v << shifts[j]), size);
+    }
+    circuit::shiftDot(be, r, cols_ptr, shifts, cols, size);
+    if(fromBits(r, size) != expected) { failures++; printf("shiftDot = %ld, expected %ld\n", fromBits(r, size), expected); }
+
+    // wavefront forms: column j plus / minus column j + half, and the sums of groups of 0, 1, 3 and 4 columns
+    const int half = cols / 2, nums[4] = {0, 1, 3, 4};
+    circuit::add_batch(be, batch_ptr, cols_ptr, cols_ptr + half, half, size);
+    circuit::sub_batch(be, batch_ptr + half, cols_ptr, cols_ptr + half, half, size);
+    for(int j = 0; j < half; j++) {
+      if(fromBits(batch_bits[j], size) != wrap(col_vals[j] + col_vals[j + half], size)) { failures++; printf("add_batch[%d] = %ld\n", j, fromBits(batch_bits[j], size)); }
+      if(fromBits(batch_bits[half + j], size) != wrap(col_vals[j] - col_vals[j + half], size)) { failures++; printf("sub_batch[%d] = %ld\n", j, fromBits(batch_bits[half + j], size)); }
+    }
+    // the same additions with a and the sums in bit-plane order, bit i of pair j at i * half + j, and b element-major
+    bool planes_a[cols / 2 * 64], planes_s[cols / 2 * 64];
+    bool *plane_s[cols / 2];
+    const bool *plane_a[cols / 2], *plane_b[cols / 2];
+    for(int j = 0; j < half; j++) {
+      for(int i = 0; i < size; i++) planes_a[i * half + j] = cols_bits[j][i];
+      plane_s[j] = &planes_s[j]; plane_a[j] = &planes_a[j]; plane_b[j] = cols_bits[j + half];
+    }
+    circuit::add_batch(be, plane_s, plane_a, plane_b, half, size, half, half, 1);
+    for(int j = 0; j < half; j++) {
+      for(int i = 0; i < size; i++) r[i] = planes_s[i * half + j];
+      if(fromBits(r, size) != wrap(col_vals[j] + col_vals[j + half], size)) { failures++; printf("strided add_batch[%d] = %ld\n", j, fromBits(r, size)); }
+    }
+    bool *const *groups[4] = {cols_ptr, cols_ptr + 1, cols_ptr + 2, cols_ptr + 4};
+    circuit::reduce_add_batch(be, batch_ptr, groups, nums, 4, size);
+    for(int g = 0; g < 4; g++) {
+      long group_sum = 0;
+      for(int j = 0; j < nums[g]; j++) group_sum = wrap(group_sum + col_vals[groups[g] - cols_ptr + j], size);
+      if(fromBits(batch_bits[g], size) != group_sum) { failures++; printf("reduce_add_batch[%d] = %ld, expected %ld\n", g, fromBits(batch_bits[g], size), group_sum); }
+    }
+
+    // matVec: 3 rows of plaintext weights (some negative, some zero) over the columns, fixed point
+    const int mv_rows = 3, mv_frac = rng() % 4;
+    int mv_weights[mv_rows * cols], mv_bias[mv_rows];
+    int32_t mv_in[cols], mv_expected[mv_rows];
+    for(int q = 0; q < mv_rows * cols; q++) mv_weights[q] = rng() % 3 ? (int) (rng() % 33) - 16 : 0;
+    for(int q = 0; q < mv_rows; q++) mv_bias[q] = (int) (rng() % 9) - 4;
+    for(int j = 0; j < cols; j++) mv_in[j] = col_vals[j];
+    circuit::matVec(be, batch_ptr, mv_weights, mv_bias, cols_ptr, mv_rows, cols, mv_frac, size);
+    ref_matVec(mv_expected, mv_weights, mv_bias, mv_in, mv_rows, cols, mv_frac, size);
+    for(int q = 0; q < mv_rows; q++) {
+      if(fromBits(batch_bits[q], size) != mv_expected[q]) { failures++; printf("matVec[%d] = %ld, expected %d\n", q, fromBits(batch_bits[q], size), mv_expected[q]); }
+    }
+
+    // argmax and top-k over 11 scores
+    const int n = 11, k = 1 + rng() % 5, index_bits = 4;
+    long scores[n];
+    bool score_bits[n][64], index[64], out_idx[5][64], out_val[5][64];
+    bool *score_ptr[n], *idx_ptr[5], *val_ptr[5];
+    for(int q = 0; q < n; q++) {
+      scores[q] = wrap(q == 0 || rng() % 4 ? rng() : scores[q-1], size);  // some ties
+      toBits(score_bits[q], scores[q], size);
+      score_ptr[q] = score_bits[q];
+    }
+    for(int q = 0; q < 5; q++) { idx_ptr[q] = out_idx[q]; val_ptr[q] = out_val[q]; }
+    int best = 0;
+    for(int q = 1; q < n; q++) if(scores[q] > scores[best]) best = q;
+    circuit::argmax(be, index, r, score_ptr, n, size, index_bits);
+    if(fromBitsUnsigned(index, index_bits) != best || fromBits(r, size) != scores[best]) { failures++; printf("argmax index %ld, expected %d\n", fromBitsUnsigned(index, index_bits), best); }
+    circuit::topk(be, idx_ptr, val_ptr, score_ptr, n, k, size, index_bits);
+    std::vector<long> sorted(scores, scores + n);
+    std::sort(sorted.rbegin(), sorted.rend());
+    for(int q = 0; q < k; q++) {
+      const long i = fromBitsUnsigned(out_idx[q], index_bits);
+      if(fromBits(out_val[q], size) != sorted[q] || i < 0 || i >= n || scores[i] != sorted[q]) { failures++; printf("topk rank %d: %ld, expected %ld\n", q, fromBits(out_val[q], size), sorted[q]); }
+    }
+
+    // top-k of 6 scores, several of them at the minimum: the padding records hold that value too
+    const int nm = 6, km = 1 + rng() % 5;
+    long min_scores[nm];
+    for(int q = 0; q < nm; q++) {
+      min_scores[q] = rng() % 2 ? -(1L << (size-1)) : wrap(rng(), size);
+      toBits(score_bits[q], min_scores[q], size);
+    }
+    circuit::topk(be, idx_ptr, val_ptr, score_ptr, nm, km, size, 3);
+    std::vector<long> min_sorted(min_scores, min_scores + nm);
+    std::sort(min_sorted.rbegin(), min_sorted.rend());
+    bool seen[nm] = {false};
+    for(int q = 0; q < km; q++) {
+      const long i = fromBitsUnsigned(out_idx[q], 3);
+      if(fromBits(out_val[q], size) != min_sorted[q] || i >= nm || seen[i] || min_scores[i] != min_sorted[q]) {
+        failures++; printf("topk at the minimum, k=%d rank %d: index %ld, value %ld, expected %ld\n", km, q, i, fromBits(out_val[q], size), min_sorted[q]);
+      }
+      else seen[i] = true;
+    }
+
+    if(failures > 10) break;
+  }
+  printf("%ld trials at %d bits: %ld failures\n", trials, size, failures);
+
+  // cost of each kernel, no evaluation
+  CountBackend cnt;
+  CountDepth *x = cnt.alloc(size), *y = cnt.alloc(size), *z = cnt.alloc(size), *cols_cnt[cols];
+  CountDepth *sums_cnt[cols];
+  for(int j = 0; j < cols; j++) {
+    cols_cnt[j] = cnt.alloc(size);
+    sums_cnt[j] = cnt.alloc(size);
+  }
+  CountDepth *const *pairs_cnt[4] = {cols_cnt, cols_cnt + 2, cols_cnt + 4, cols_cnt + 6};
+  const int pair_nums[4] = {2, 2, 2, 2};
+  printf("%-16s %12s %8s %8s\n", "circuit", "bootstraps", "depth", "batches");
+#define REPORT(NAME, CALL) cnt.reset(); CALL; printf("%-16s %12ld %8d %8ld\n", NAME, cnt.bootstraps, cnt.depth, cnt.batches);
+  REPORT("add", circuit::add(cnt, z, x, y, size))
+  CountDepth *adder_in_cnt[2] = {x, y}, *adder_out_cnt[1] = {z};
+  REPORT("Bristol add", evalBristol(cnt, adder_out_cnt, adder_in_cnt, adder))
+  REPORT("sub", circuit::sub(cnt, z, x, y, size))
+  REPORT("lessThan", circuit::lessThan(cnt, z, x, y, size))
+  REPORT("twosComplement", circuit::twosComplement(cnt, z, x, size))
+  REPORT("mult", circuit::mult(cnt, z, x, y, size))
+  REPORT("mult_fixed n/2", circuit::mult_fixed(cnt, z, x, y, size, size / 2))
+  REPORT("mult_fixed n-1", circuit::mult_fixed(cnt, z, x, y, size, size - 1))
+  REPORT("reduce_add of 8", circuit::reduce_add(cnt, z, cols_cnt, cols, size))
+  REPORT("4 adds, batched", circuit::add_batch(cnt, sums_cnt, cols_cnt, cols_cnt + cols / 2, cols / 2, size))
+  REPORT("4 sums of 2", circuit::reduce_add_batch(cnt, sums_cnt, pairs_cnt, pair_nums, 4, size))
+  const int mv_weights_cnt[4 * cols] = {3, -1, 0, 2, 5, 1, -4, 0,  1, 1, 1, 1, 0, 0, 0, 0,
+                                       -7, 0, 2, 0, 3, 3, 0, 1,  0, 2, 0, 2, 0, 2, 0, 2};
+  REPORT("matVec 4x8", circuit::matVec(cnt, sums_cnt, mv_weights_cnt, (const int*) NULL, cols_cnt, 4, cols, size / 2, size))
+  REPORT("shiftDot", circuit::shiftDot(cnt, z, cols_cnt, shifts, cols, size))
+  REPORT("argmax of 8", circuit::argmax(cnt, y, z, cols_cnt, cols, size, 3))
+  CountDepth *top_idx[2] = {x, y};
+  REPORT("top-2 of 8", circuit::topk(cnt, top_idx, (CountDepth**) NULL, cols_cnt, cols, 2, size, 3))
+#undef REPORT
+  cnt.release(x, size);
+  cnt.release(y, size);
+  cnt.release(z, size);
+  for(int j = 0; j < cols; j++) {
+    cnt.release(cols_cnt[j], size);
+    cnt.release(sums_cnt[j], size);
+  }
+  return failures != 0;
+}
@@ -0,0 +1,77 @@
+/*
+Client side encryption of a dataset into the SERVER_PREDICT messages read by SHE_batch and SHE_server.
+Usage: SHE_encrypt <secret key> <data csv> <bits> <scale factor> <out> [--seeded]
+Every row of data is one sample of features, quantized with float_to_fixed(x, bits, scale factor). With --seeded the
+masks come from a seed per sample (wire.hpp) and only the seed and the b values are written.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "encryption.hpp"
+#include "io.hpp"
+#include "numeric.hpp"
+#include "params.hpp"
+#include "server.hpp"
+#include "wire.hpp"
+
+int main(int argc, char** argv) {
+  if(argc < 6) {
+    cout << "Usage: " << argv[0] << " <secret key> <data csv> <bits> <scale factor> <out> [--seeded]" << endl;
+    return 1;
+  }
+  const bool seeded = argc > 6 && strcmp(argv[6], "--seeded") == 0;
+  FILE *key_file = fopen(argv[1], "rb");
+  if(key_file == NULL) {
+    cout << "Error: failed to open file." << endl;
+    return 1;
+  }
+  TFheGateBootstrappingSecretKeySet *sk = new_tfheGateBootstrappingSecretKeySet_fromFile(key_file);
+  fclose(key_file);
+  const TFheGateBootstrappingParameterSet *params = sk->params;
+
+  vector<vector<double>> data = readFile(argv[2]);
+  if(data.empty()) return 1;
+  const int bits = atoi(argv[3]);
+  const double factor = atof(argv[4]);
+  int out = open(argv[5], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(out < 0) {
+    cout << "Error: failed to open file." << endl;
+    return 1;
+  }
+
+  size_t written = 0;
+  int status = 0;
+  for(size_t s = 0; s < data.size() && status == 0; s++) {
+    const int dim = data[s].size();
+    vector<int32_t> x = float_to_fixed<int32_t>(data[s], bits, factor);
+    const uint32_t op = seeded ? SERVER_PREDICT | WIRE_SEEDED : SERVER_PREDICT;
+    status = writeHeader(out, op, dim, bits, paramsId(params));
+    if(seeded) {
+      SeededSamples cipher;
+      encrypt_seeded(cipher, x.data(), dim, bits, sk);
+      if(status == 0) status = writeSeededSamples(out, cipher);
+      written += sizeof(WireHeader) + WIRE_SEED_BYTES + cipher.b.size() * sizeof(int32_t);
+    }
+    else {
+      LweSample *cipher = new_gate_bootstrapping_ciphertext_array(bits, params);
+      for(int i = 0; i < dim && status == 0; i++) {
+        encrypt_bits(cipher, x[i], bits, sk);
+        status = writeSamples(out, cipher, bits, params->in_out_params);
+      }
+      delete_gate_bootstrapping_ciphertext_array(bits, cipher);
+      written += sizeof(WireHeader) + (size_t) dim * bits * (params->in_out_params->n + 1) * sizeof(int32_t);
+    }
+  }
+  close(out);
+  if(status < 0) {
+    cout << "Error: failed to write " << argv[5] << endl;
+    return 1;
+  }
+  printf("%zu samples, %zu bytes%s\n", data.size(), written, seeded ? " (seeded)" : "");
+  delete_gate_bootstrapping_secret_keyset(sk);
+  return 0;
+}
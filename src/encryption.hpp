@@ -2,11 +2,16 @@
 Implements higher level encryption functions to make using tfhe easier
 */
 
+#pragma once
+
 #include <cstddef>
+#include <cstdint>
+#include <random>
 #include <tfhe/tfhe.h>
 #include <tfhe/tfhe_io.h>
 #include <vector>
 #include "omp_constants.hpp"
+#include "wire.hpp"
 
 
 using namespace std;
@@ -52,3 +57,53 @@ vector<T> decrypt(LweSample** cipher, int length, const TFheGateBootstrappingSec
   }
   return plaintext;
 }
+
+/* Encrypt the low bits bits of plaintext, for values narrower than their type */
+inline void encrypt_bits(LweSample* cipher, int32_t plaintext, int bits, const TFheGateBootstrappingSecretKeySet* sk) {
+  for(int i = 0; i < bits; i++) {
+    bootsSymEncrypt(&cipher[i], (plaintext >> i) & 1, sk);
+  }
+}
+
+/* Decrypt a bits-bit two's complement value, sign extended */
+inline int32_t decrypt_bits(const LweSample* cipher, int bits, const TFheGateBootstrappingSecretKeySet* sk) {
+  uint32_t plaintext = 0;
+  for(int i = 0; i < bits; i++) {
+    plaintext |= (uint32_t) bootsSymDecrypt(&cipher[i], sk) << i;
+  }
+  const int shift = 32 - bits;
+  return (int32_t) (plaintext << shift) >> shift;
+}
+
+/* Decrypt n values into a tensor, to be checked against the references of reference.hpp */
+inline void decrypt_tensor(int32_t* plaintext, LweSample** cipher, size_t n, int bits, const TFheGateBootstrappingSecretKeySet* sk) {
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(size_t i = 0; i < n; i++) {
+    plaintext[i] = decrypt_bits(cipher[i], bits, sk);
+  }
+}
+
+/*
+  Seeded encryption of the low bits bits of count values, bit i of value v at sample v * bits + i: the same
+  samples as encrypt_bits, but with the masks drawn from a fresh random seed (seededMask), so only the seed and the
+  b values have to be stored or sent
+*/
+inline void encrypt_seeded(SeededSamples& cipher, const int32_t* plaintext, size_t count, int bits, const TFheGateBootstrappingSecretKeySet* sk) {
+  const LweParams *params = sk->params->in_out_params;
+  const int32_t n = params->n;
+  const int32_t *key = sk->lwe_key->key;
+  std::random_device device;
+  for(int i = 0; i < WIRE_SEED_BYTES; i++) cipher.seed[i] = (uint8_t) device();
+  cipher.b.resize(count * bits);
+  // noise as lweSymEncrypt: gaussian of standard deviation alpha_min around the message
+  std::mt19937_64 rng(((uint64_t) device() << 32) | device());
+  std::normal_distribution<double> noise(0, params->alpha_min);
+  std::vector<Torus32> a(n);
+  for(size_t k = 0; k < count * bits; k++) {
+    seededMask(a.data(), cipher.seed, k, n);
+    const int bit = (plaintext[k / bits] >> (k % bits)) & 1;
+    uint32_t b = (uint32_t) modSwitchToTorus32(bit ? 1 : -1, 8) + (uint32_t) dtot32(noise(rng));
+    for(int32_t i = 0; i < n; i++) b += (uint32_t) a[i] * (uint32_t) key[i];
+    cipher.b[k] = (Torus32) b;
+  }
+}
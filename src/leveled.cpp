@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "leveled.hpp"
+#include "bootstrap.hpp"
+/*
+Leveled evaluation with CMux gates.
+CMux(s, a, b) = b + s [x] (a - b): the external product of a TGSW encryption of s with a TRLWE sample is an encryption
+of s * (a - b), with the noise of (a - b) plus the decomposition terms of cmuxVariance(). The noise grows additively
+with the depth of the tree, not with its width, and there is no rounding of the phase as in a bootstrap.
+Reference: Chillotti, Gama, Georgieva, Izabachene, "TFHE: Fast Fully Homomorphic Encryption over the Torus", sec. 3
+*/
+
+LeveledValue* new_LeveledValue_array(const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  LeveledValue *x = new LeveledValue[count];
+  for(int i = 0; i < count; i++) {
+    x[i].acc = new_TLweSample(ck->bkFFT->accum_params);
+    x[i].bits = bits;
+    x[i].variance = 0;
+  }
+  return x;
+}
+
+void delete_LeveledValue_array(const int count, LeveledValue* x) {
+  for(int i = 0; i < count; i++) {
+    delete_TLweSample(x[i].acc);
+  }
+  delete[] x;
+}
+
+TGswSampleFFT* new_selector_array(const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  return new_TGswSampleFFT_array(count, ck->bkFFT->bk_params);
+}
+
+void delete_selector_array(const int count, TGswSampleFFT* s) {
+  delete_TGswSampleFFT_array(count, s);
+}
+
+/* mu[i] = +-1/8 for bit i of value, 0 above bits */
+static void encodeBits(TorusPolynomial* mu, const int32_t value, const int bits) {
+  const Torus32 one = modSwitchToTorus32(1, 8);
+  torusPolynomialClear(mu);
+  for(int i = 0; i < bits; i++) {
+    mu->coefsT[i] = ((value >> i) & 1) ? one : -one;
+  }
+}
+
+void encryptLeveled(LeveledValue* result, const int32_t value, const TFheGateBootstrappingSecretKeySet* sk) {
+  const TLweParams *accum_params = sk->cloud.bkFFT->accum_params;
+  const double alpha = accum_params->alpha_min;
+  TorusPolynomial *mu = new_TorusPolynomial(accum_params->N);
+  encodeBits(mu, value, result->bits);
+  tLweSymEncrypt(result->acc, mu, alpha, &sk->tgsw_key->tlwe_key);
+  result->variance = alpha * alpha;
+  delete_TorusPolynomial(mu);
+}
+
+void encryptSelector(TGswSampleFFT* result, const int bit, const TFheGateBootstrappingSecretKeySet* sk) {
+  const TGswParams *bk_params = sk->cloud.bkFFT->bk_params;
+  TGswSample *temp = new_TGswSample(bk_params);
+  tGswSymEncryptInt(temp, bit & 1, bk_params->tlwe_params->alpha_min, sk->tgsw_key);
+  tGswToFFTConvert(result, temp, bk_params);
+  delete_TGswSample(temp);
+}
+
+int32_t decryptLeveled(const LeveledValue* x, const TFheGateBootstrappingSecretKeySet* sk) {
+  TorusPolynomial *phase = new_TorusPolynomial(sk->cloud.bkFFT->accum_params->N);
+  tLwePhase(phase, x->acc, &sk->tgsw_key->tlwe_key);
+  uint32_t plaintext = 0;
+  for(int i = 0; i < x->bits; i++) {
+    plaintext |= (uint32_t) (phase->coefsT[i] > 0) << i;
+  }
+  delete_TorusPolynomial(phase);
+  const int shift = 32 - x->bits;
+  return (int32_t) (plaintext << shift) >> shift;
+}
+
+void leveledConstant(LeveledValue* result, const int32_t value, const TFheGateBootstrappingCloudKeySet* ck) {
+  const TLweParams *accum_params = ck->bkFFT->accum_params;
+  TorusPolynomial *mu = new_TorusPolynomial(accum_params->N);
+  encodeBits(mu, value, result->bits);
+  tLweNoiselessTrivial(result->acc, mu, accum_params);
+  result->variance = 0;
+  delete_TorusPolynomial(mu);
+}
+
+/*
+External product noise: (k+1) l N (Bg/2)^2 var_bk from the gadget decomposition of a - b times the TGSW noise, and
+(1 + kN) eps^2, eps = 1 / (2 Bg^l), from the precision of the decomposition
+*/
+double cmuxVariance(const TFheGateBootstrappingCloudKeySet* ck) {
+  const TGswParams *bk_params = ck->bkFFT->bk_params;
+  const TLweParams *tlwe_params = bk_params->tlwe_params;
+  const double alpha = tlwe_params->alpha_min;
+  const double beta = bk_params->halfBg;
+  const double eps = 1.0 / (2 * std::pow((double) bk_params->Bg, bk_params->l));
+  return (tlwe_params->k + 1) * bk_params->l * tlwe_params->N * beta * beta * alpha * alpha + (1 + tlwe_params->k * tlwe_params->N) * eps * eps;
+}
+
+/* Key switch noise: n t var_ks from the key samples, and the rounding of every coefficient to t * basebit bits */
+static double keySwitchVariance(const TFheGateBootstrappingCloudKeySet* ck) {
+  const LweKeySwitchKey *ks = ck->bkFFT->ks;
+  const double alpha = ks->out_params->alpha_min;
+  const double rounding = std::pow(2.0, -2 * (ks->t * ks->basebit + 1)) / 3;
+  return ks->n * (ks->t * alpha * alpha + rounding);
+}
+
+/*
+A gate bootstrap output has the noise of n CMux levels (the blind rotation) and a key switch: extracted values that
+are not noisier than that are valid gate inputs as they are
+*/
+double leveledBudget(const TFheGateBootstrappingCloudKeySet* ck) {
+  return ck->params->in_out_params->n * cmuxVariance(ck) + keySwitchVariance(ck);
+}
+
+/* result = s ? a : b. a and b are read into temp before result is written */
+static void cmuxOne(LeveledValue* result, const TGswSampleFFT* s, const LeveledValue* a, const LeveledValue* b, TLweSample* temp, const double cmux_variance, const TFheGateBootstrappingCloudKeySet* ck) {
+  const TLweParams *accum_params = ck->bkFFT->accum_params;
+  const double variance = std::max(a->variance, b->variance) + cmux_variance;
+  tLweCopy(temp, a->acc, accum_params);
+  tLweSubTo(temp, b->acc, accum_params);
+  tGswFFTExternMulToTLwe(temp, s, ck->bkFFT->bk_params);
+  tLweCopy(result->acc, b->acc, accum_params);
+  tLweAddTo(result->acc, temp, accum_params);
+  result->bits = a->bits;
+  result->variance = variance;
+}
+
+void cmux(LeveledValue* result, const TGswSampleFFT* s, const LeveledValue* a, const LeveledValue* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  const double cmux_variance = cmuxVariance(ck);
+  #pragma omp parallel num_threads(NUM_THREADS)
+  {
+    TLweSample *temp = new_TLweSample(ck->bkFFT->accum_params);
+    #pragma omp for
+    for(int i = 0; i < count; i++) {
+      cmuxOne(&result[i], &s[i], &a[i], &b[i], temp, cmux_variance, ck);
+    }
+    delete_TLweSample(temp);
+  }
+}
+
+void leveledReLU(LeveledValue* result, const TGswSampleFFT* negative, const LeveledValue* x, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  LeveledValue *zero = new_LeveledValue_array(count, 0, ck);
+  for(int i = 0; i < count; i++) {
+    zero[i].bits = x[i].bits;  // all bits -1/8
+    leveledConstant(&zero[i], 0, ck);
+  }
+  cmux(result, negative, zero, x, count, ck);
+  delete_LeveledValue_array(count, zero);
+}
+
+void leveledMax(LeveledValue* result, const TGswSampleFFT* less, const LeveledValue* a, const LeveledValue* b, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  cmux(result, less, b, a, count, ck);
+}
+
+/*
+CMux tree: level j selects between the pairs of level j - 1 with index bit j, halving the number of nodes. Levels are
+double buffered, the nodes of one level are independent
+*/
+void leveledLUT(LeveledValue* result, const TGswSampleFFT* index, const int index_bits, const int32_t* table, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  const int M = 1 << index_bits;
+  const double cmux_variance = cmuxVariance(ck);
+  LeveledValue *leaves = new_LeveledValue_array(M, bits, ck);
+  LeveledValue *nodes = new_LeveledValue_array(M / 2 + 1, bits, ck);
+  LeveledValue *src = leaves, *dst = nodes;
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(int m = 0; m < M; m++) {
+    leveledConstant(&src[m], table[m], ck);
+  }
+  for(int j = 0; j < index_bits; j++) {
+    const int width = M >> (j + 1);
+    #pragma omp parallel num_threads(NUM_THREADS)
+    {
+      TLweSample *temp = new_TLweSample(ck->bkFFT->accum_params);
+      #pragma omp for
+      for(int m = 0; m < width; m++) {
+        cmuxOne(&dst[m], &index[j], &src[2*m + 1], &src[2*m], temp, cmux_variance, ck);
+      }
+      delete_TLweSample(temp);
+    }
+    std::swap(src, dst);
+  }
+  tLweCopy(result->acc, src[0].acc, ck->bkFFT->accum_params);
+  result->bits = bits;
+  result->variance = src[0].variance;
+  delete_LeveledValue_array(M, leaves);
+  delete_LeveledValue_array(M / 2 + 1, nodes);
+}
+
+int leveledExtract(LweSample** result, const LeveledValue* x, const int count, const TFheGateBootstrappingCloudKeySet* ck) {
+  const LweParams *extract_params = ck->bkFFT->extract_params;
+  const TLweParams *accum_params = ck->bkFFT->accum_params;
+  const double ks_variance = keySwitchVariance(ck), budget = leveledBudget(ck);
+  std::vector<int> offset(count + 1, 0);
+  for(int i = 0; i < count; i++) {
+    offset[i + 1] = offset[i] + x[i].bits;
+  }
+  const int total = offset[count];
+  LweSample *u = new_LweSample_array(total, extract_params);
+  std::vector<LweSample*> out(total);
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(int i = 0; i < count; i++) {
+    for(int b = 0; b < x[i].bits; b++) {
+      tLweExtractLweSampleIndex(&u[offset[i] + b], x[i].acc, b, extract_params, accum_params);
+      out[offset[i] + b] = &result[i][b];
+    }
+  }
+  batchKeySwitch(out.data(), u, total, ck);
+  delete_LweSample_array(total, u);
+
+  // refresh the noisy values in one batch
+  std::vector<LweSample*> noisy;
+  int refreshed = 0;
+  for(int i = 0; i < count; i++) {
+    if(x[i].variance + ks_variance <= budget) continue;
+    refreshed++;
+    for(int b = 0; b < x[i].bits; b++) {
+      noisy.push_back(&result[i][b]);
+    }
+  }
+  if(!noisy.empty()) {
+    const LweParams *in_out_params = ck->params->in_out_params;
+    LweSample *temp = new_LweSample_array(noisy.size(), in_out_params);
+    for(size_t k = 0; k < noisy.size(); k++) {
+      lweCopy(&temp[k], noisy[k], in_out_params);
+    }
+    batchBootstrap(noisy.data(), temp, modSwitchToTorus32(1, 8), noisy.size(), ck);
+    delete_LweSample_array(noisy.size(), temp);
+  }
+  return refreshed;
+}
@@ -0,0 +1,66 @@
+/**
+    * Leveled CMux evaluation: select between values, or look up a small table, with selector bits the key owner
+    * encrypted. A demonstration of the primitive, not an evaluation mode for the network.
+    * A value of `bits` bits lives in one TRLWE sample, bit i (LSB first) in coefficient i as +-1/8, the encoding of
+    * the gate-bootstrapped bits. A selector bit is a TGSW sample. CMux(s, a, b) = b + s [x] (a - b) is one external
+    * product: no bootstrapping, only a little noise per level, so a selection costs one external product for all bits
+    * of a value, and a table of 2^k entries 2^k - 1 external products in a CMux tree over k index bits.
+    * leveledExtract() takes the bits back to gate-bootstrapping LWE samples: sample extraction and a key switch, and a
+    * bootstrap only if the tracked noise is above the budget gates can take as input.
+    *
+    * Limit: libtfhe has no circuit bootstrapping, so the server cannot turn an LWE bit it computed into a TGSW
+    * selector, nor a gate-bootstrapped value into a LeveledValue. Selectors and non-constant data come only from the
+    * key owner (encryptSelector / encryptLeveled). leveledReLU and leveledMax therefore need the sign or comparison
+    * bit encrypted by the key owner, which holds for client inputs only: they cannot replace the gate ReLU or max
+    * (alu.hpp) on values the server computes, such as the preactivations of a layer. leveledLUT is usable where the
+    * index is client data, e.g. the index bits of a categorical feature.
+*/
+
+#pragma once
+
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+#include <cstdint>
+#include "omp_constants.hpp"
+
+struct LeveledValue {
+  TLweSample* acc;  // bit i in coefficient i, +-1/8
+  int bits;
+  double variance;  // noise variance estimate of every coefficient
+};
+
+LeveledValue* new_LeveledValue_array(const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
+void delete_LeveledValue_array(const int count, LeveledValue* x);
+TGswSampleFFT* new_selector_array(const int count, const TFheGateBootstrappingCloudKeySet* ck);
+void delete_selector_array(const int count, TGswSampleFFT* s);
+
+// Key owner side
+void encryptLeveled(LeveledValue* result, const int32_t value, const TFheGateBootstrappingSecretKeySet* sk);
+void encryptSelector(TGswSampleFFT* result, const int bit, const TFheGateBootstrappingSecretKeySet* sk);
+int32_t decryptLeveled(const LeveledValue* x, const TFheGateBootstrappingSecretKeySet* sk);
+
+// Noiseless value, in two's complement
+void leveledConstant(LeveledValue* result, const int32_t value, const TFheGateBootstrappingCloudKeySet* ck);
+
+// Noise added by one CMux level, and the largest variance leveledExtract() passes on without bootstrapping
+double cmuxVariance(const TFheGateBootstrappingCloudKeySet* ck);
+double leveledBudget(const TFheGateBootstrappingCloudKeySet* ck);
+
+// result[i] = s[i] ? a[i] : b[i], for count values. result may alias a or b
+void cmux(LeveledValue* result, const TGswSampleFFT* s, const LeveledValue* a, const LeveledValue* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+
+// result[i] = negative[i] ? 0 : x[i], negative[i] the sign bit of x[i]
+void leveledReLU(LeveledValue* result, const TGswSampleFFT* negative, const LeveledValue* x, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+// result[i] = less[i] ? b[i] : a[i], less[i] the bit a[i] < b[i]
+void leveledMax(LeveledValue* result, const TGswSampleFFT* less, const LeveledValue* a, const LeveledValue* b, const int count, const TFheGateBootstrappingCloudKeySet* ck);
+// result = table[index], index given by index_bits selectors (LSB first), table of 2^index_bits values of `bits` bits
+void leveledLUT(LeveledValue* result, const TGswSampleFFT* index, const int index_bits, const int32_t* table, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
+
+/**
+  Extracts the bits of count values into result[i] (bits samples each, gate parameters). The values whose variance
+  after the key switch is above leveledBudget() are bootstrapped, all of them in one batch.
+  Returns the number of values bootstrapped
+*/
+int leveledExtract(LweSample** result, const LeveledValue* x, const int count, const TFheGateBootstrappingCloudKeySet* ck);
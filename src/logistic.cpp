@@ -5,12 +5,25 @@
 #include "numeric.hpp"
 #include "alu.hpp"
 #include "matrix.hpp"
+#include "checkpoint.hpp"
+#include "worker.hpp"
 
 using namespace std;
 
+/**
+The fixed point scale has to be a power of two for mult_fixed to rescale products with a shift. Others are rounded down
+*/
+static int scaleBits(size_t scale_factor) {
+  int bits = 0;
+  while((size_t) 2 << bits <= scale_factor) bits++;
+  if(scale_factor != (size_t) 1 << bits)
+    cout << "Warning: scale factor " << scale_factor << " is not a power of two, using " << (1 << bits) << endl;
+  return bits;
+}
+
 
 ApproxLogRegression::ApproxLogRegression(string weight_path, string coefs_path, int dim, const TFheGateBootstrappingCloudKeySet* ck, size_t size, size_t scale_factor, bool mode_clip)
-  : weight_path(weight_path), coefs_path(coefs_path), dim(dim), ck(ck), size(size), scale_factor(scale_factor), mode_clip(mode_clip) {
+  : weight_path(weight_path), coefs_path(coefs_path), dim(dim), ck(ck), size(size), scale_factor(scale_factor), frac_bits(scaleBits(scale_factor)), mode_clip(mode_clip) {
   // load weights from text file and convert to fixed precision integer
   vector<int> plaintext_weights = float_to_fixed<int>(readFile(weight_path)[0], size, 1, mode_clip);  // FIXME opaque code
   // FIXME make more standardised weight initialization subroutine
@@ -23,10 +36,8 @@ ApproxLogRegression::ApproxLogRegression(string weight_path, string coefs_path,
     cout << " " << plaintext_weights[i];
   }
   cout << endl;
-  // load polynomial coefficients
-  vector<int16_t> plaintext_coefs = float_to_fixed<int16_t>(readFile(coefs_path)[0], size, scale_factor, mode_clip);
-  // FIXME make more general. Multiplying by 10 here so that original function can be recovered
-  plaintext_coefs[0] *= scale_factor;
+  // load polynomial coefficients, fixed point with frac_bits fraction bits
+  vector<int> plaintext_coefs = float_to_fixed<int>(readFile(coefs_path)[0], size, 1 << frac_bits, mode_clip);
   degree = plaintext_coefs.size() - 1;
   coefs = new LweSample*[degree + 1];
   cout << "Converting coefficients:";
@@ -41,7 +52,7 @@ ApproxLogRegression::ApproxLogRegression(string weight_path, string coefs_path,
 }
 
 ApproxLogRegression::ApproxLogRegression(vector<double> weights_in, vector<double> coefs_in, int dim, const TFheGateBootstrappingCloudKeySet* ck, size_t size, size_t scale_factor, bool mode_clip)
-  : dim(dim), ck(ck), size(size), scale_factor(scale_factor), mode_clip(mode_clip) {
+  : dim(dim), ck(ck), size(size), scale_factor(scale_factor), frac_bits(scaleBits(scale_factor)), mode_clip(mode_clip) {
   // load weights from text file and convert to fixed precision integer
   vector<int> plaintext_weights = float_to_fixed<int>(weights_in, size, 1, mode_clip);
   // FIXME make more standardised weight initialization subroutine
@@ -54,11 +65,8 @@ ApproxLogRegression::ApproxLogRegression(vector<double> weights_in, vector<doubl
     cout << " " << plaintext_weights[i];
   }
   cout << endl;
-  // load polynomial coefficients
-  vector<int16_t> plaintext_coefs = float_to_fixed<int16_t>(coefs_in, size, scale_factor, mode_clip);
-
-  // FIXME make more general. Multiplying by 10 here so that original function can be recovered
-  plaintext_coefs[0] *= scale_factor;
+  // load polynomial coefficients, fixed point with frac_bits fraction bits
+  vector<int> plaintext_coefs = float_to_fixed<int>(coefs_in, size, 1 << frac_bits, mode_clip);
   degree = plaintext_coefs.size() - 1;
   coefs = new LweSample*[degree + 1];
   cout << "Converting coefficients:";
@@ -89,12 +97,14 @@ void ApproxLogRegression::predict(LweSample* y, LweSample** X) {
   Reference: https://en.wikipedia.org/wiki/Horner%27s_method
   f(X) = c_0 + c_1 * X + ... + c_n * X^n
   NOTE X is a scalar here
+  X and the coefficients are fixed point with frac_bits fraction bits; mult_fixed rescales every product, so all
+  the b_k stay at that scale
 */
 void ApproxLogRegression::approxSigmoid(LweSample* y, LweSample* X) {
   LweSample *temp = new_gate_bootstrapping_ciphertext_array(size, ck->params);
   copy(y, coefs[degree], ck, size);
   for(int i = degree-1; i >= 0; i--) {
-    mult(temp, y, X, ck, size);
+    mult_fixed(temp, y, X, ck, size, frac_bits);
     add(y, coefs[i], temp, ck, size);
   }
   delete_gate_bootstrapping_ciphertext_array(size, temp);
@@ -115,3 +125,216 @@ Dot product of weights and X: a = X * W, where X is of shape (d, 1) and W is of
 void ApproxLogRegression::preactivation(LweSample* y, LweSample** X) {
   dot(y, weights, X, dim, ck, size);
 }
+
+/**
+The weighted deltas are one mult_batch and their sum a single add into pre. Products and sums wrap modulo 2^size,
+so the result is exactly the preactivation of the updated sample
+*/
+void ApproxLogRegression::updatePreactivation(LweSample* pre, const int* features, LweSample** deltas, const int count) {
+  if(count <= 0) return;
+  LweSample **prod = new LweSample*[count];
+  vector<const LweSample*> w(count), x(count);
+  for(int k = 0; k < count; k++) {
+    prod[k] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    w[k] = weights[features[k]];
+    x[k] = deltas[k];
+  }
+  mult_batch(prod, w.data(), x.data(), count, ck, size);
+  LweSample *sum = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  reduce_add(sum, prod, count, ck, size);
+  add(pre, pre, sum, ck, size);
+  delete_gate_bootstrapping_ciphertext_array(size, sum);
+  for(int k = 0; k < count; k++) {
+    delete_gate_bootstrapping_ciphertext_array(size, prod[k]);
+  }
+  delete[] prod;
+}
+
+/**
+Inference on count samples at once. Same computation as predict, but the weight x feature products of all
+samples are one mult_batch, and each Horner step multiplies all samples together.
+With a Checkpointer, layer 0 is the preactivation and layer k the value after the k-th Horner step; the run
+resumes after the last layer found in the checkpoint directory.
+*/
+void ApproxLogRegression::predict_batch(LweSample** y, LweSample*** X, const int count, Checkpointer* checkpoint, WorkerPool* pool) {
+  LweSample **pre = new LweSample*[count];
+  LweSample **temp = new LweSample*[count];
+  for(int s = 0; s < count; s++) {
+    pre[s] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    temp[s] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  }
+
+  int last = checkpoint != NULL ? checkpoint->lastLayer() : -1;
+  if(last > degree || (last >= 0 && checkpoint->load(0, pre, count, size) < 0))
+    last = -1;
+  if(last > 0 && checkpoint->load(last, y, count, size) < 0)
+    last = 0;
+  if(last >= 0)
+    cout << "Resuming after layer " << last << endl;
+
+  if(last < 0 && pool != NULL) {
+    // preactivation on the workers
+    pool->dot(pre, weights, X, count, dim, size);
+    if(checkpoint != NULL)
+      checkpoint->save(0, pre, count, size);
+  } else if(last < 0) {
+    // preactivation
+    LweSample **prod = new LweSample*[count * dim];
+    vector<const LweSample*> w(count * dim), x(count * dim);
+    for(int s = 0; s < count; s++) {
+      for(int i = 0; i < dim; i++) {
+        prod[s*dim + i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+        w[s*dim + i] = weights[i];
+        x[s*dim + i] = X[s][i];
+      }
+    }
+    mult_batch(prod, w.data(), x.data(), count * dim, ck, size);
+    #pragma omp parallel for num_threads(NUM_THREADS)
+    for(int s = 0; s < count; s++) {
+      reduce_add(pre[s], &prod[s*dim], dim, ck, size);
+    }
+    for(int i = 0; i < count * dim; i++) {
+      delete_gate_bootstrapping_ciphertext_array(size, prod[i]);
+    }
+    delete[] prod;
+    if(checkpoint != NULL)
+      checkpoint->save(0, pre, count, size);
+  }
+
+  // activation, Horner's algorithm as in approxSigmoid. Step k computes b_{degree-k}
+  if(last <= 0) {
+    for(int s = 0; s < count; s++) {
+      copy(y[s], coefs[degree], ck, size);
+    }
+  }
+  for(int k = (last > 0 ? last : 0) + 1; k <= degree; k++) {
+    mult_fixed_batch(temp, y, pre, count, ck, size, frac_bits);
+    #pragma omp parallel for num_threads(NUM_THREADS)
+    for(int s = 0; s < count; s++) {
+      add(y[s], coefs[degree - k], temp[s], ck, size);
+    }
+    if(checkpoint != NULL)
+      checkpoint->save(k, y, count, size);
+  }
+  if(checkpoint != NULL)
+    checkpoint->flush();
+
+  for(int s = 0; s < count; s++) {
+    delete_gate_bootstrapping_ciphertext_array(size, pre[s]);
+    delete_gate_bootstrapping_ciphertext_array(size, temp[s]);
+  }
+  delete[] pre;
+  delete[] temp;
+}
+
+MultiLogRegression::MultiLogRegression(string weight_path, string coefs_path, int dim, const TFheGateBootstrappingCloudKeySet* ck, size_t size, size_t scale_factor, bool mode_clip)
+  : classes(0), dim(dim), coefs(NULL), degree(-1), ck(ck), size(size), frac_bits(scaleBits(scale_factor)), mode_clip(mode_clip) {
+  vector<vector<double>> coefs_in = readFile(coefs_path);
+  init(readFile(weight_path), coefs_in.empty() ? vector<double>() : coefs_in[0]);
+}
+
+MultiLogRegression::MultiLogRegression(vector<vector<double>> weights_in, vector<double> coefs_in, int dim, const TFheGateBootstrappingCloudKeySet* ck, size_t size, size_t scale_factor, bool mode_clip)
+  : classes(0), dim(dim), coefs(NULL), degree(-1), ck(ck), size(size), frac_bits(scaleBits(scale_factor)), mode_clip(mode_clip) {
+  init(weights_in, coefs_in);
+}
+
+void MultiLogRegression::init(const vector<vector<double>>& weights_in, const vector<double>& coefs_in) {
+  classes = weights_in.size();
+  weights.assign(classes * dim, 0);
+  bias.assign(classes, 0);
+  cout << "Converting weights:";
+  for(int c = 0; c < classes; c++) {
+    if(weights_in[c].size() != (size_t) dim && weights_in[c].size() != (size_t) dim + 1)
+      cout << endl << "Warning: class " << c << " has " << weights_in[c].size() << " weights for " << dim << " inputs" << endl;
+    vector<double> row(weights_in[c].begin(), weights_in[c].begin() + min(weights_in[c].size(), (size_t) dim));
+    row.resize(dim, 0);
+    vector<int> fixed = float_to_fixed<int>(row, size, 1 << frac_bits, mode_clip);
+    copy(fixed.begin(), fixed.end(), weights.begin() + c * dim);
+    if(weights_in[c].size() > (size_t) dim)
+      bias[c] = float_to_fixed<int>(weights_in[c][dim], size, 1 << frac_bits, mode_clip);
+    cout << " [";
+    for(int i = 0; i < dim; i++) cout << (i ? " " : "") << weights[c * dim + i];
+    cout << "; " << bias[c] << "]";
+  }
+  cout << endl;
+  // polynomial coefficients, fixed point with frac_bits fraction bits
+  if(coefs_in.empty()) {
+    cout << "Error: no polynomial coefficients, only predictClass is available" << endl;
+    degree = -1;
+    return;
+  }
+  vector<int> plaintext_coefs = float_to_fixed<int>(coefs_in, size, 1 << frac_bits, mode_clip);
+  degree = plaintext_coefs.size() - 1;
+  coefs = new LweSample*[degree + 1];
+  cout << "Converting coefficients:";
+  for(int i = 0; i < degree + 1; i++) {
+    coefs[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    CONSTANT(coefs[i], plaintext_coefs[i], ck, size);
+    cout << " " << plaintext_coefs[i];
+  }
+  cout << endl;
+}
+
+MultiLogRegression::~MultiLogRegression() {
+  for(int i = 0; i < degree + 1; i++) {
+    delete_gate_bootstrapping_ciphertext_array(size, coefs[i]);
+  }
+  delete[] coefs;
+}
+
+int MultiLogRegression::getIndexBits() const {
+  int bits = 1;
+  while((1 << bits) < classes) bits++;
+  return bits;
+}
+
+void MultiLogRegression::preactivation(LweSample** z, LweSample** X) {
+  matVec(z, weights.data(), bias.data(), X, classes, dim, frac_bits, ck, size);
+}
+
+/**
+Horner's algorithm as in ApproxLogRegression::approxSigmoid, one mult_fixed_batch over the classes per step
+*/
+int MultiLogRegression::predict(LweSample** y, LweSample** X) {
+  if(degree < 0) {
+    cout << "Error: the model has no polynomial coefficients" << endl;
+    return -1;
+  }
+  LweSample **pre = new LweSample*[classes];
+  LweSample **temp = new LweSample*[classes];
+  for(int c = 0; c < classes; c++) {
+    pre[c] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    temp[c] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  }
+  preactivation(pre, X);
+  for(int c = 0; c < classes; c++) {
+    ::copy(y[c], coefs[degree], ck, size);
+  }
+  for(int i = degree - 1; i >= 0; i--) {
+    mult_fixed_batch(temp, y, pre, classes, ck, size, frac_bits);
+    #pragma omp parallel for num_threads(NUM_THREADS)
+    for(int c = 0; c < classes; c++) {
+      add(y[c], coefs[i], temp[c], ck, size);
+    }
+  }
+  for(int c = 0; c < classes; c++) {
+    delete_gate_bootstrapping_ciphertext_array(size, pre[c]);
+    delete_gate_bootstrapping_ciphertext_array(size, temp[c]);
+  }
+  delete[] pre;
+  delete[] temp;
+  return 0;
+}
+
+void MultiLogRegression::predictClass(LweSample* index, LweSample** X) {
+  LweSample **pre = new LweSample*[classes];
+  for(int c = 0; c < classes; c++) {
+    pre[c] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  }
+  preactivation(pre, X);
+  argmax(index, NULL, pre, classes, ck, size, getIndexBits());
+  for(int c = 0; c < classes; c++) {
+    delete_gate_bootstrapping_ciphertext_array(size, pre[c]);
+  }
+  delete[] pre;
+}
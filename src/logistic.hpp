@@ -23,6 +23,9 @@ TODO: replace raw pointers with smart
 #include <vector>
 #include <string>
 
+class Checkpointer;
+class WorkerPool;
+
 class ApproxLogRegression {
   private:
 
@@ -37,6 +40,7 @@ class ApproxLogRegression {
     const TFheGateBootstrappingCloudKeySet* ck;  // cloud key set
     size_t size;  // number of bits of precision
     size_t scale_factor;  // factor for fixed-float conversions
+    int frac_bits;  // log2(scale_factor): coefficients, inputs and activations have frac_bits fraction bits
     bool mode_clip;  // If true, use range [-2^(n-1), 2^(n-1)-1] and clip to range, else use [-2^(n-2), 2^(n-2)-1] instead
 
   public:
@@ -50,6 +54,13 @@ class ApproxLogRegression {
     */
     void predict(LweSample* y, LweSample** X);
 
+    /**
+      Run inference on count samples X[0..count-1], evaluated together.
+      If checkpoint is set, every layer is checkpointed and the run resumes from the last saved layer.
+      If pool is set, the preactivation dot products are evaluated on its workers
+    */
+    void predict_batch(LweSample** y, LweSample*** X, const int count, Checkpointer* checkpoint=NULL, WorkerPool* pool=NULL);
+
     /**
       Compute polynomial approximation to sigmoid
     */
@@ -65,5 +76,70 @@ class ApproxLogRegression {
     */
     void preactivation(LweSample* y, LweSample** X);
 
+    /**
+      pre += sum of weights[features[k]] * deltas[k] over count changed features: the preactivation of X + deltas
+      from that of X, at the cost of count products instead of dim
+    */
+    void updatePreactivation(LweSample* pre, const int* features, LweSample** deltas, const int count);
+
+    int getDim() const { return dim; }
+    size_t getSize() const { return size; }
+
+
+};
+
+/**
+  Multinomial (K-class) logistic regression. The K x d weights stay plaintext, fixed point at scale_factor: the K
+  preactivations are one matVec (matrix.hpp), which shares partial sums of the encrypted inputs between the classes,
+  and the K sigmoids run their Horner steps together. A weight file has one row per class, of dim weights and
+  optionally the intercept last.
+  The class is the argmax of the preactivations: the sigmoid is increasing, so its approximation is not needed there
+*/
+class MultiLogRegression {
+  private:
+
+    std::vector<int> weights;  // classes x dim, at scale_factor
+    std::vector<int> bias;  // classes, at scale_factor
+    int classes;
+    int dim;  // input data dimension
+    LweSample **coefs;
+    int degree;  // polynomial degree, -1 without coefficients: predict() is then not available
+    const TFheGateBootstrappingCloudKeySet* ck;  // cloud key set
+    size_t size;  // number of bits of precision
+    int frac_bits;  // log2(scale_factor)
+    bool mode_clip;
+
+    void init(const std::vector<std::vector<double>>& weights_in, const std::vector<double>& coefs_in);
+
+  public:
+
+    MultiLogRegression(std::string weight_path, std::string coefs_path, int dim, const TFheGateBootstrappingCloudKeySet* ck, size_t size, size_t scale_factor, bool mode_clip=true);
+
+    MultiLogRegression(std::vector<std::vector<double>> weights_in, std::vector<double> coefs_in, int dim, const TFheGateBootstrappingCloudKeySet* ck, size_t size, size_t scale_factor, bool mode_clip=true);
+
+    ~MultiLogRegression();
+
+    // owns the coefficient samples
+    MultiLogRegression(const MultiLogRegression&) = delete;
+    MultiLogRegression& operator=(const MultiLogRegression&) = delete;
+
+    /**
+      Per-class scores: y[c] = sigmoid(W[c] . X + b[c]) for the classes. Returns -1 if the model has no coefficients
+    */
+    int predict(LweSample** y, LweSample** X);
+
+    /**
+      Encrypted class of X, on getIndexBits() bits
+    */
+    void predictClass(LweSample* index, LweSample** X);
+
+    /**
+      Preactivations z[c] = W[c] . X + b[c], at scale_factor
+    */
+    void preactivation(LweSample** z, LweSample** X);
 
+    int getClasses() const { return classes; }
+    int getDim() const { return dim; }
+    size_t getSize() const { return size; }
+    int getIndexBits() const;
 };
@@ -0,0 +1,177 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "lut.hpp"
+#include "bootstrap.hpp"
+/*
+Programmable bootstrapping on digits.
+Encoding: m in [0, M), M = 2^bits, is the torus value m/(2M). After modulus switching to 2N the phase of a digit
+is about m*N/M, so the blind rotation X^{-phase} * v reads coefficient v[m*N/M + e] of the test vector.
+Inputs are shifted by half a box, 1/(4M), so that the whole box [m*N/M, (m+1)*N/M) of the test vector holds table[m].
+Reference: Chillotti, Joye, Paillier, "Programmable bootstrapping enables efficient homomorphic inference of deep neural networks"
+*/
+
+/* Digits of other widths do not decode reliably with the default parameter set */
+static int checkBits(const int bits) {
+  if(bits < LUT_MIN_BITS || bits > LUT_MAX_BITS) {
+    std::cout << "Error: digits of " << bits << " bits, only " << LUT_MIN_BITS << " to " << LUT_MAX_BITS << " are supported" << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+static void buildTestVector(TorusPolynomial* testvect, const int* table, const int bits, const Torus32 one, const bool bit_out, const int bit_index) {
+  const int32_t N = testvect->N;
+  const int M = 1 << bits;
+  for(int32_t j = 0; j < N; j++) {
+    const int v = ((table[(int64_t) j * M / N] % M) + M) % M;
+    if(bit_out) {
+      testvect->coefsT[j] = ((v >> bit_index) & 1) ? one : -one;
+    } else {
+      testvect->coefsT[j] = modSwitchToTorus32(v, 2*M);
+    }
+  }
+}
+
+/* temp = x + (0, 1/(4M)): centers each digit in its box of the test vector */
+static LweSample* centerDigits(const LweSample* x, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  const LweParams *in_out_params = ck->params->in_out_params;
+  const Torus32 half_box = modSwitchToTorus32(1, 4 << bits);
+  LweSample *temp = new_LweSample_array(count, in_out_params);
+  for(int k = 0; k < count; k++) {
+    lweCopy(&temp[k], &x[k], in_out_params);
+    temp[k].b += half_box;
+  }
+  return temp;
+}
+
+void encryptDigit(LweSample* result, const int m, const int bits, const TFheGateBootstrappingSecretKeySet* sk) {
+  const int M = 1 << bits;
+  const double alpha = sk->params->in_out_params->alpha_min;
+  lweSymEncrypt(result, modSwitchToTorus32(((m % M) + M) % M, 2*M), alpha, sk->lwe_key);
+}
+
+int decryptDigit(const LweSample* x, const int bits, const TFheGateBootstrappingSecretKeySet* sk) {
+  const int M = 1 << bits;
+  return modSwitchFromTorus32(lwePhase(x, sk->lwe_key), 2*M) & (M - 1);
+}
+
+void digitConstant(LweSample* result, const int m, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  const int M = 1 << bits;
+  lweNoiselessTrivial(result, modSwitchToTorus32(((m % M) + M) % M, 2*M), ck->params->in_out_params);
+}
+
+int lut(LweSample* result, const LweSample* x, const int* table, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(checkBits(bits) < 0) return -1;
+  if(count <= 0) return 0;
+  TorusPolynomial *testvect = new_TorusPolynomial(ck->bkFFT->accum_params->N);
+  buildTestVector(testvect, table, bits, 0, false, 0);
+  // x is copied before any output is written, so result may alias x
+  LweSample *temp = centerDigits(x, count, bits, ck);
+  std::vector<LweSample*> r(count);
+  for(int k = 0; k < count; k++) r[k] = &result[k];
+
+  batchBootstrap(r.data(), temp, testvect, count, ck);
+
+  delete_LweSample_array(count, temp);
+  delete_TorusPolynomial(testvect);
+  return 0;
+}
+
+/**
+Bit i is bootstrapped to +-2^i/(4M) and shifted by 2^i/(4M), giving 0 or 2^i/(2M); the digit is the sum over i.
+The shifts add up to (M-1)/(4M), which is the starting value of each digit.
+*/
+int bitsToDigits(LweSample* digits, LweSample** values, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(checkBits(bits) < 0) return -1;
+  if(count <= 0) return 0;
+  const LweParams *in_out_params = ck->params->in_out_params;
+  const int M = 1 << bits;
+  LweSample *in = new_LweSample_array(count, in_out_params);
+  LweSample *out = new_LweSample_array(count, in_out_params);
+  std::vector<LweSample*> r(count);
+  for(int k = 0; k < count; k++) {
+    r[k] = &out[k];
+    lweNoiselessTrivial(&digits[k], modSwitchToTorus32(M - 1, 4*M), in_out_params);
+  }
+  for(int i = 0; i < bits; i++) {
+    for(int k = 0; k < count; k++) {
+      lweCopy(&in[k], &values[k][i], in_out_params);
+    }
+    batchBootstrap(r.data(), in, modSwitchToTorus32(1 << i, 4*M), count, ck);
+    for(int k = 0; k < count; k++) {
+      lweAddTo(&digits[k], &out[k], in_out_params);
+    }
+  }
+  delete_LweSample_array(count, out);
+  delete_LweSample_array(count, in);
+  return 0;
+}
+
+/**
+Bit j of every digit is one table lookup whose test vector holds +-1/8, the gate bootstrapping encoding
+*/
+int digitsToBits(LweSample** values, const LweSample* digits, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(checkBits(bits) < 0) return -1;
+  if(count <= 0) return 0;
+  static const Torus32 MU = modSwitchToTorus32(1, 8);
+  const int M = 1 << bits;
+  std::vector<int> identity(M);
+  for(int v = 0; v < M; v++) identity[v] = v;
+
+  TorusPolynomial *testvect = new_TorusPolynomial(ck->bkFFT->accum_params->N);
+  LweSample *temp = centerDigits(digits, count, bits, ck);
+  std::vector<LweSample*> r(count);
+  for(int j = 0; j < bits; j++) {
+    buildTestVector(testvect, identity.data(), bits, MU, true, j);
+    for(int k = 0; k < count; k++) r[k] = &values[k][j];
+    batchBootstrap(r.data(), temp, testvect, count, ck);
+  }
+  delete_LweSample_array(count, temp);
+  delete_TorusPolynomial(testvect);
+  return 0;
+}
+
+std::vector<int> reluTable(const int bits) {
+  const int M = 1 << bits;
+  std::vector<int> table(M);
+  for(int v = 0; v < M; v++) {
+    table[v] = v < M / 2 ? v : 0;
+  }
+  return table;
+}
+
+std::vector<int> signTable(const int bits) {
+  const int M = 1 << bits;
+  std::vector<int> table(M);
+  for(int v = 0; v < M; v++) {
+    table[v] = v < M / 2 ? 0 : 1;
+  }
+  return table;
+}
+
+/**
+  Input v is read as the two's complement value s, i.e. the real s / in_factor.
+  Output is round(out_factor / (1 + exp(-s / in_factor))), clipped to [0, M-1]
+*/
+std::vector<int> sigmoidTable(const int bits, const double in_factor, const double out_factor) {
+  const int M = 1 << bits;
+  std::vector<int> table(M);
+  for(int v = 0; v < M; v++) {
+    const int s = v < M / 2 ? v : v - M;
+    int y = (int) std::round(out_factor / (1 + std::exp(-s / in_factor)));
+    table[v] = y < 0 ? 0 : (y > M - 1 ? M - 1 : y);
+  }
+  return table;
+}
+
+int lutReLU(LweSample** result, LweSample** a, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(checkBits(bits) < 0) return -1;
+  std::vector<int> table = reluTable(bits);
+  LweSample *digits = new_gate_bootstrapping_ciphertext_array(count, ck->params);
+  bitsToDigits(digits, a, count, bits, ck);
+  lut(digits, digits, table.data(), count, bits, ck);
+  digitsToBits(result, digits, count, bits, ck);
+  delete_gate_bootstrapping_ciphertext_array(count, digits);
+  return 0;
+}
@@ -0,0 +1,44 @@
+/**
+    * Implements programmable bootstrapping (lookup table evaluation) on small-digit encodings.
+    * A digit holds an integer m in [0, 2^bits) in a single LWE sample, as the torus value m / 2^(bits+1).
+    * The upper half of the torus is left empty (padding bit), so the blind rotation can read an arbitrary
+    * table instead of the negacyclic +-mu of gate bootstrapping.
+    * bits must stay in LUT_MIN_BITS..LUT_MAX_BITS with the default parameter set: the decoding margin is
+    * 1 / 2^(bits+2). The functions that evaluate digits return -1 for other widths.
+    *
+    * Converting a bit-sliced value to a digit and back costs 2*bits bootstraps, more than most gate circuits on
+    * the bits: a lookup only pays off on values that stay digits across several ops.
+
+*/
+
+#pragma once
+
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+#include <vector>
+#include "omp_constants.hpp"
+
+#define LUT_MIN_BITS 2
+#define LUT_MAX_BITS 4
+
+void encryptDigit(LweSample* result, const int m, const int bits, const TFheGateBootstrappingSecretKeySet* sk);
+int decryptDigit(const LweSample* x, const int bits, const TFheGateBootstrappingSecretKeySet* sk);
+void digitConstant(LweSample* result, const int m, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
+
+// result[i] = table[x[i]] for count digits. table has 2^bits entries, taken modulo 2^bits
+int lut(LweSample* result, const LweSample* x, const int* table, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
+
+// Conversions between the bit-sliced format (one LweSample array of `bits` bits per value, LSB first) and digits
+int bitsToDigits(LweSample* digits, LweSample** values, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
+int digitsToBits(LweSample** values, const LweSample* digits, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
+
+// Tables over two's complement digits. signTable gives 1 for negative values (the MSB)
+std::vector<int> reluTable(const int bits);
+std::vector<int> signTable(const int bits);
+std::vector<int> sigmoidTable(const int bits, const double in_factor, const double out_factor);
+
+// ReLU of count bit-sliced values of `bits` bits: 2*bits + 1 bootstraps per value, all of them batched. The gate ReLU
+// (relu in matrix.hpp) takes bits - 1: this one demonstrates the conversions, it is not the ReLU of the network
+int lutReLU(LweSample** result, LweSample** a, const int count, const int bits, const TFheGateBootstrappingCloudKeySet* ck);
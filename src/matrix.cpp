@@ -1,91 +1,300 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
 #include "alu.hpp"
+#include "bootstrap.hpp"
 #include "matrix.hpp"
+#include "shiftmodel.hpp"
+#include "tensor.hpp"
+#include "worker.hpp"
 /**
-Element-wise addition
+Element-wise addition, all elements as one add_batch
 
 TODO implement integer and matrix classes to simplify all this code
 
 */
 void mat_add(LweSample*** sum, LweSample*** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  std::vector<LweSample*> r;
+  std::vector<const LweSample*> x, y;
   for(int i = 0; i < rows; i++) {
     for(int j = 0; j < cols; j++) {
-      add(sum[i][j], a[i][j], b[i][j], ck, size);
+      r.push_back(sum[i][j]); x.push_back(a[i][j]); y.push_back(b[i][j]);
     }
   }
+  add_batch(r.data(), x.data(), y.data(), r.size(), ck, size);
 }
 
 void elem_mult(LweSample*** prod, LweSample*** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  std::vector<LweSample*> r;
+  std::vector<const LweSample*> x, y;
   for(int i = 0; i < rows; i++) {
     for(int j = 0; j < cols; j++) {
-      mult(prod[i][j], a[i][j], b[i][j], ck, size);
+      r.push_back(prod[i][j]); x.push_back(a[i][j]); y.push_back(b[i][j]);
     }
   }
+  mult_batch(r.data(), x.data(), y.data(), r.size(), ck, size);
 }
 
 /**
 Multiply each row of matrix elementwise by vector
 */
 void elem_mult(LweSample*** prod, LweSample*** a, LweSample** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  std::vector<LweSample*> r;
+  std::vector<const LweSample*> x, y;
   for(int i = 0; i < rows; i++) {
     for(int j = 0; j < cols; j++) {
-      mult(prod[i][j], a[i][j], b[j], ck, size);
+      r.push_back(prod[i][j]); x.push_back(a[i][j]); y.push_back(b[j]);
     }
   }
+  mult_batch(r.data(), x.data(), y.data(), r.size(), ck, size);
 }
 
 void elem_mult(LweSample*** prod, LweSample** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  std::vector<LweSample*> r;
+  std::vector<const LweSample*> x, y;
   for(int i = 0; i < rows; i++) {
     for(int j = 0; j < cols; j++) {
-      mult(prod[i][j], a[j], b[i][j], ck, size);
+      r.push_back(prod[i][j]); x.push_back(a[j]); y.push_back(b[i][j]);
     }
   }
+  mult_batch(r.data(), x.data(), y.data(), r.size(), ck, size);
 }
 
 void elem_mult(LweSample** prod, LweSample** a, LweSample** b, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  for(int j = 0; j < cols; j++) {
-    mult(prod[j], a[j], b[j], ck, size);
-  }
+  mult_batch(prod, a, b, cols, ck, size);
 }
 
-void mat_mult(LweSample*** prod, LweSample*** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
-  LweSample ***b_transpose = new LweSample**[rows];
-  for(int i = 0; i < rows; i++) {
-    b_transpose[i] = new LweSample*[cols];
-    for(int j = 0; j < cols; j++) {
-      b_transpose[i][j] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
-      copy(b_transpose[i][j], b[j][i], ck, size);
-    }
+/**
+(M x K) * (K x N) matrix product.
+Outputs are split into MATRIX_TILE x MATRIX_TILE tiles, evaluated one after the other. For a tile, the
+MATRIX_TILE^2 * K products are evaluated with one mult_batch, and the outputs are reduce summed straight from
+their K products with one reduce_add_batch. The tiles are not spread over threads: both batches already run their
+gates on all of them, and nested OpenMP regions would run serialized. b is read through a transposed pointer
+table, no ciphertext is copied.
+*/
+void mat_mult(LweSample*** prod, LweSample*** a, LweSample*** b, const int M, const int K, const int N, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  LweSample ***b_transpose = new LweSample**[N];
+  for(int j = 0; j < N; j++) {
+    b_transpose[j] = new LweSample*[K];
   }
+  transpose(b_transpose, b, K, N);
 
-  LweSample ***temp = new LweSample**[rows];
-  for(int i = 0; i < rows; i++) {
-    temp[i] = new LweSample*[cols];
-    for(int j = 0; j < cols; j++) {
-      temp[i][j] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  const int tiles_i = (M + MATRIX_TILE - 1) / MATRIX_TILE,
+            tiles_j = (N + MATRIX_TILE - 1) / MATRIX_TILE;
+  for(int t = 0; t < tiles_i * tiles_j; t++) {
+    const int i0 = (t / tiles_j) * MATRIX_TILE, i1 = std::min(i0 + MATRIX_TILE, M),
+              j0 = (t % tiles_j) * MATRIX_TILE, j1 = std::min(j0 + MATRIX_TILE, N);
+    const int count = (i1 - i0) * (j1 - j0) * K;
+    LweSample **temp = new LweSample*[count];
+    std::vector<const LweSample*> x(count), y(count);
+    int q = 0;
+    for(int i = i0; i < i1; i++) {
+      for(int j = j0; j < j1; j++) {
+        for(int k = 0; k < K; k++, q++) {
+          temp[q] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+          x[q] = a[i][k];
+          y[q] = b_transpose[j][k];
+        }
+      }
+    }
+    mult_batch(temp, x.data(), y.data(), count, ck, size);
+    std::vector<LweSample*> sums;
+    std::vector<LweSample**> groups;
+    q = 0;
+    for(int i = i0; i < i1; i++) {
+      for(int j = j0; j < j1; j++, q += K) {
+        sums.push_back(prod[i][j]);
+        groups.push_back(&temp[q]);
+      }
+    }
+    std::vector<int> nums(sums.size(), K);
+    reduce_add_batch(sums.data(), groups.data(), nums.data(), sums.size(), ck, size);
+    for(q = 0; q < count; q++) {
+      delete_gate_bootstrapping_ciphertext_array(size, temp[q]);
     }
+    delete[] temp;
   }
 
-  for(int i = 0; i < rows; i++) {
-    elem_mult(temp, b_transpose, a[i], rows, cols, ck, size);
-    for(int j = 0; j < cols; j++) {
-      reduce_add(prod[i][j], temp[i], cols, ck, size);
+  for(int j = 0; j < N; j++) {
+    delete[] b_transpose[j];
+  }
+  delete[] b_transpose;
+}
+
+/**
+Square case kept for existing callers: a is rows x cols, b is cols x cols
+*/
+void mat_mult(LweSample*** prod, LweSample*** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  mat_mult(prod, a, b, rows, cols, cols, ck, size);
+}
+
+/**
+Plaintext (M x K) times encrypted (K x N).
+Multiplying by a public weight w needs no AND gates: w * x is the sum of x << t over the set bits t of |w|, and
+shifts are free. Every output collects the shifted terms of its K weights; the positive and the negative sums of all
+outputs are one reduce_add_batch and the differences one sub_batch, as in shiftLayer.
+*/
+void mat_mult(LweSample*** prod, int** a, LweSample*** b, const int M, const int K, const int N, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  // mag has at most 32 bits, and shifting it by 32 or more is undefined
+  const int shifts = std::min((int) size, 32);
+  std::vector<std::vector<LweSample*>> pos(M * N), neg(M * N);
+  #pragma omp parallel for num_threads(NUM_THREADS) schedule(dynamic)
+  for(int o = 0; o < M * N; o++) {
+    const int i = o / N, j = o % N;
+    for(int k = 0; k < K; k++) {
+      const int w = a[i][k];
+      const unsigned int mag = w < 0 ? -(unsigned int) w : w;
+      for(int t = 0; t < shifts; t++) {
+        if(!((mag >> t) & 1)) continue;
+        LweSample *term = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+        leftShift(term, b[k][j], ck, size, t);
+        (w < 0 ? neg : pos)[o].push_back(term);
+      }
     }
   }
 
-  for(int i = 0; i < rows; i++) {
-    for(int j = 0; j < cols; j++) {
-      delete_gate_bootstrapping_ciphertext_array(size, b_transpose[i][j]);
-      delete_gate_bootstrapping_ciphertext_array(size, temp[i][j]);
+  // positive sums into prod (0 if none), negative ones of the outputs that have negative terms
+  std::vector<LweSample*> sums, neg_out, neg_sums;
+  std::vector<LweSample**> groups;
+  std::vector<int> nums;
+  for(int o = 0; o < M * N; o++) {
+    sums.push_back(prod[o / N][o % N]);
+    groups.push_back(pos[o].data());
+    nums.push_back(pos[o].size());
+  }
+  for(int o = 0; o < M * N; o++) {
+    if(neg[o].empty()) continue;
+    sums.push_back(new_gate_bootstrapping_ciphertext_array(size, ck->params));
+    groups.push_back(neg[o].data());
+    nums.push_back(neg[o].size());
+    neg_out.push_back(prod[o / N][o % N]);
+    neg_sums.push_back(sums.back());
+  }
+  reduce_add_batch(sums.data(), groups.data(), nums.data(), sums.size(), ck, size);
+  sub_batch(neg_out.data(), neg_out.data(), neg_sums.data(), neg_out.size(), ck, size);
+  for(LweSample *neg_sum: neg_sums) delete_gate_bootstrapping_ciphertext_array(size, neg_sum);
+  for(int o = 0; o < M * N; o++) {
+    for(LweSample *term: pos[o]) delete_gate_bootstrapping_ciphertext_array(size, term);
+    for(LweSample *term: neg[o]) delete_gate_bootstrapping_ciphertext_array(size, term);
+  }
+}
+
+/**
+Power-of-two weights: every term sign * 2^exp of a weight is the input with its bits relabelled, so as in the
+plaintext mat_mult above, an output is the sum of its positive terms (and the bias) minus that of its negative
+terms. Inputs are sign extended (or truncated) to layer.bits, and right shifts copy the sign bit, so signed
+activations stay signed. The sums of all rows advance together (reduce_add_batch, then one sub_batch), and ReLU ANDs
+the bits of all rows with the complement of their sign in one batch
+*/
+void shiftLayer(LweSample** out, LweSample** in, const int in_bits, const ShiftLayer& layer, const TFheGateBootstrappingCloudKeySet* ck,
+                WorkerPool* pool) {
+  const int bits = layer.bits, terms = layer.terms, rows = layer.rows;
+  std::vector<std::vector<LweSample*>> pos(rows), neg(rows);
+  #pragma omp parallel for num_threads(NUM_THREADS) schedule(dynamic)
+  for(int r = 0; r < rows; r++) {
+    for(int q = r * layer.cols * terms; q < (r + 1) * layer.cols * terms; q++) {
+      if(layer.signs[q] == 0) continue;
+      const LweSample *x = in[(q / terms) % layer.cols];
+      LweSample *term = new_gate_bootstrapping_ciphertext_array(bits, ck->params);
+      for(int k = 0; k < bits; k++) {
+        const int from = std::min(k - layer.exps[q], bits - 1);
+        if(from < 0)
+          bootsCONSTANT(&term[k], 0, ck);
+        else
+          bootsCOPY(&term[k], &x[std::min(from, in_bits - 1)], ck);
+      }
+      (layer.signs[q] > 0 ? pos : neg)[r].push_back(term);
+    }
+    if(layer.bias[r] != 0) {
+      LweSample *term = new_gate_bootstrapping_ciphertext_array(bits, ck->params);
+      CONSTANT(term, layer.bias[r], ck, bits);
+      pos[r].push_back(term);
     }
-    delete[] b_transpose[i];
-    delete[] temp[i];
   }
-  delete[] b_transpose;
-  delete[] temp;
 
+  // positive sums into out, negative ones of the rows that have negative terms
+  std::vector<LweSample*> sums(out, out + rows), neg_out, neg_sums;
+  std::vector<LweSample**> groups;
+  std::vector<int> nums;
+  for(int r = 0; r < rows; r++) {
+    groups.push_back(pos[r].data());
+    nums.push_back(pos[r].size());
+  }
+  for(int r = 0; r < rows; r++) {
+    if(neg[r].empty()) continue;
+    sums.push_back(new_gate_bootstrapping_ciphertext_array(bits, ck->params));
+    groups.push_back(neg[r].data());
+    nums.push_back(neg[r].size());
+    neg_out.push_back(out[r]);
+    neg_sums.push_back(sums.back());
+  }
+  if(pool != NULL)
+    pool->reduce_add_batch(sums.data(), groups.data(), nums.data(), sums.size(), bits);
+  else
+    reduce_add_batch(sums.data(), groups.data(), nums.data(), sums.size(), ck, bits);
+  sub_batch(neg_out.data(), neg_out.data(), neg_sums.data(), neg_out.size(), ck, bits);
+  for(LweSample *neg_sum: neg_sums) delete_gate_bootstrapping_ciphertext_array(bits, neg_sum);
+  for(int r = 0; r < rows; r++) {
+    for(LweSample *term: pos[r]) delete_gate_bootstrapping_ciphertext_array(bits, term);
+    for(LweSample *term: neg[r]) delete_gate_bootstrapping_ciphertext_array(bits, term);
+  }
 
+  if(layer.relu && bits > 1) {
+    LweSample *positive = new_gate_bootstrapping_ciphertext_array(rows, ck->params);
+    std::vector<LweSample*> y;
+    std::vector<const LweSample*> a, p;
+    for(int r = 0; r < rows; r++) {
+      bootsNOT(&positive[r], &out[r][bits - 1], ck);
+      for(int k = 0; k < bits - 1; k++) {
+        y.push_back(&out[r][k]);
+        a.push_back(&out[r][k]);
+        p.push_back(&positive[r]);
+      }
+    }
+    bootsAND_batch(y.data(), a.data(), p.data(), y.size(), ck);
+    for(int r = 0; r < rows; r++) {
+      bootsCONSTANT(&out[r][bits - 1], 0, ck);
+    }
+    delete_gate_bootstrapping_ciphertext_array(rows, positive);
+  }
+}
 
+/**
+Layer l reads the outputs of layer l - 1 at the width of that layer
+*/
+void shiftNetwork(LweSample** out, LweSample** in, const ShiftModel& model, const TFheGateBootstrappingCloudKeySet* ck,
+                  WorkerPool* pool) {
+  LweSample **x = in;
+  int x_rows = model.layers[0].cols, x_bits = model.layers[0].bits;
+  for(size_t l = 0; l < model.layers.size(); l++) {
+    const ShiftLayer& layer = model.layers[l];
+    LweSample **y = out;
+    if(l + 1 < model.layers.size()) {
+      y = new LweSample*[layer.rows];
+      for(int r = 0; r < layer.rows; r++) {
+        y[r] = new_gate_bootstrapping_ciphertext_array(layer.bits, ck->params);
+      }
+    }
+    shiftLayer(y, x, x_bits, layer, ck, pool);
+    if(x != in) {
+      for(int r = 0; r < x_rows; r++) {
+        delete_gate_bootstrapping_ciphertext_array(x_bits, x[r]);
+      }
+      delete[] x;
+    }
+    x = y;
+    x_rows = layer.rows;
+    x_bits = layer.bits;
+  }
+}
 
+/**
+circuit::matVec over the batched gates
+*/
+void matVec(LweSample** out, const int* weights, const int* bias, LweSample** x, const int rows, const int cols, const int frac_bits,
+            const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
+  TfheBackend be(ck);
+  circuit::matVec(be, out, weights, bias, x, rows, cols, frac_bits, size);
 }
 
 void dot(LweSample* result, LweSample** a, LweSample** b, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size) {
@@ -138,19 +347,148 @@ void shiftDot(LweSample* result, LweSample** a, int* b, const int cols, const TF
   seq_add(result, temp, cols, ck, size);
   bs_end=clock();
   printf("reduce_add time:%f\n",(bs_end-bs_begin)*clocks2seconds/2);
-  /*for(int i = 0; i < cols; i++) {
+  for(int i = 0; i < cols; i++) {
     delete_gate_bootstrapping_ciphertext_array(size, temp[i]);
   }
-  delete[] temp;*/
+  delete[] temp;
+}
+
+/**
+Pointer permutation only: transpose[j][i] = source[i][j] for a rows x cols source. Nothing is copied,
+so transpose aliases the ciphertexts of source
+*/
+void transpose(LweSample*** transpose, LweSample*** source, const int rows, const int cols) {
+  for(int i = 0; i < rows; i++) {
+    for(int j = 0; j < cols; j++) {
+      transpose[j][i] = source[i][j];
+    }
+  }
+}
+
+
+static bool sameShape(const CipherTensor& a, const CipherTensor& b) {
+  if(a.getRows() == b.getRows() && a.getCols() == b.getCols() && a.getBits() == b.getBits())
+    return true;
+  printf("Error: tensor shapes %dx%dx%zu and %dx%dx%zu differ\n", a.getRows(), a.getCols(), a.getBits(), b.getRows(), b.getCols(), b.getBits());
+  return false;
+}
+
+/* t itself if it is element-major, else a copy in a new tensor left in staging */
+static const CipherTensor& elementMajor(const CipherTensor& t, CipherTensor*& staging, const TFheGateBootstrappingCloudKeySet* ck) {
+  staging = NULL;
+  if(t.getLayout() == ELEMENT_MAJOR)
+    return t;
+  staging = new CipherTensor(t.getRows(), t.getCols(), t.getBits(), ck->params, ELEMENT_MAJOR);
+  staging->copyFrom(t);
+  return *staging;
+}
+
+/* Stride between the bits of an element, as circuit::adder_batch takes it */
+static size_t bitStride(const CipherTensor& t) {
+  return t.getLayout() == ELEMENT_MAJOR ? 1 : t.count();
 }
 
-void transpose(LweSample*** transpose, const LweSample*** source, const TFheGateBootstrappingCloudKeySet* ck, size_t size) {
-  // LweSample ***b_transpose = new LweSample**[array_size];
-  // for(int i = 0; i < array_size; i++) {
-  //   b_transpose[i] = new LweSample*[array_size];
-  //   for(int j = 0; j < array_size; j++) {
-  //     b_transpose[i][j] = new_gate_bootstrapping_ciphertext_array(size, params);
-  //     copy(b_transpose[i][j], b[j][i], ck, size);
-  //   }
-  // }
+/**
+Element-wise addition of tensors, all the elements as one circuit::add_batch wavefront. Each operand is read in its
+own layout: element e starts at its bit 0 and its bits are bitStride apart, so bit-plane tensors are not copied
+*/
+void mat_add(CipherTensor& sum, const CipherTensor& a, const CipherTensor& b, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(!sameShape(sum, a) || !sameShape(a, b)) return;
+  const int n = a.count();
+  std::vector<LweSample*> r(n);
+  std::vector<const LweSample*> x(n), y(n);
+  for(int e = 0; e < n; e++) {
+    r[e] = &sum.data()[sum.index(e, 0)]; x[e] = &a.data()[a.index(e, 0)]; y[e] = &b.data()[b.index(e, 0)];
+  }
+  TfheBackend be(ck);
+  circuit::add_batch(be, r.data(), x.data(), y.data(), n, a.getBits(), bitStride(sum), bitStride(a), bitStride(b));
+}
+
+void elem_mult(CipherTensor& prod, const CipherTensor& a, const CipherTensor& b, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(!sameShape(prod, a) || !sameShape(a, b)) return;
+  CipherTensor *stage_a, *stage_b, *stage_p = NULL;
+  const CipherTensor &ea = elementMajor(a, stage_a, ck), &eb = elementMajor(b, stage_b, ck);
+  CipherTensor *out = &prod;
+  if(prod.getLayout() != ELEMENT_MAJOR)
+    out = stage_p = new CipherTensor(prod.getRows(), prod.getCols(), prod.getBits(), ck->params, ELEMENT_MAJOR);
+
+  const int n = a.count();
+  std::vector<LweSample*> r(n);
+  std::vector<const LweSample*> x(n), y(n);
+  for(int e = 0; e < n; e++) {
+    r[e] = out->element(e); x[e] = ea.element(e); y[e] = eb.element(e);
+  }
+  mult_batch(r.data(), x.data(), y.data(), n, ck, a.getBits());
+
+  if(stage_p != NULL)
+    prod.copyFrom(*stage_p);
+  delete stage_a;
+  delete stage_b;
+  delete stage_p;
+}
+
+/**
+Dot product of two tensors of the same shape, read as vectors of count() elements
+*/
+void dot(LweSample* result, const CipherTensor& a, const CipherTensor& b, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(!sameShape(a, b)) return;
+  CipherTensor temp(a.getRows(), a.getCols(), a.getBits(), ck->params, ELEMENT_MAJOR);
+  elem_mult(temp, a, b, ck);
+  std::vector<LweSample*> terms(a.count());
+  for(int e = 0; e < a.count(); e++) terms[e] = temp.element(e);
+  reduce_add(result, terms.data(), terms.size(), ck, a.getBits());
+}
+
+/**
+Sum of a[e] << b[e] (b[e] >= 0) or a[e] >> -b[e] (b[e] < 0, zero filling) over the count() elements of a, as
+shiftDot above. The shifts only relabel bits, so they are copied straight out of a in either layout
+*/
+void shiftDot(LweSample* result, const CipherTensor& a, const int* b, const TFheGateBootstrappingCloudKeySet* ck) {
+  const int n = a.count(), cols = a.getCols();
+  const int bits = a.getBits();
+  CipherTensor terms(a.getRows(), cols, bits, ck->params, ELEMENT_MAJOR);
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(int e = 0; e < n; e++) {
+    LweSample *term = terms.element(e);
+    for(int k = 0; k < bits; k++) {
+      const int from = k - b[e];
+      if(from < 0 || from >= bits)
+        bootsCONSTANT(&term[k], 0, ck);
+      else
+        bootsCOPY(&term[k], a.bit(e / cols, e % cols, from), ck);
+    }
+  }
+  std::vector<LweSample*> ptrs(n);
+  for(int e = 0; e < n; e++) ptrs[e] = terms.element(e);
+  reduce_add(result, ptrs.data(), n, ck, bits);
+}
+
+/**
+ReLU of every element: the bits below the MSB are ANDed with NOT(sign), the MSB becomes 0. One batch of
+count() * (bits-1) gates, which reads whole bit planes in order in the bit-plane layout
+*/
+void relu(CipherTensor& result, const CipherTensor& a, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(!sameShape(result, a)) return;
+  const int n = a.count(), cols = a.getCols();
+  const size_t bits = a.getBits();
+  if(n == 0 || bits == 0) return;
+  LweSample *positive = new_gate_bootstrapping_ciphertext_array(n, ck->params);
+  for(int e = 0; e < n; e++) {
+    bootsNOT(&positive[e], a.bit(e / cols, e % cols, bits - 1), ck);
+  }
+  const int count = n * (bits - 1);
+  std::vector<LweSample*> r(count);
+  std::vector<const LweSample*> x(count), y(count);
+  for(size_t k = 0; k < bits - 1; k++) {
+    for(int e = 0; e < n; e++) {
+      r[k * n + e] = result.bit(e / cols, e % cols, k);
+      x[k * n + e] = a.bit(e / cols, e % cols, k);
+      y[k * n + e] = &positive[e];
+    }
+  }
+  bootsAND_batch(r.data(), x.data(), y.data(), count, ck);
+  for(int e = 0; e < n; e++) {
+    bootsCONSTANT(result.bit(e / cols, e % cols, bits - 1), 0, ck);
+  }
+  delete_gate_bootstrapping_ciphertext_array(n, positive);
 }
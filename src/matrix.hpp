@@ -2,8 +2,9 @@
 * Implements basic matrix operations on LweSamples
 * Operations supported are:
   1. addition
-  2. multiplication
-  3. dot product (vectors)
+  2. multiplication, element-wise and (M x K) * (K x N), encrypted or plaintext left operand
+  3. dot product (vectors), plaintext matrix times encrypted vector
+  4. the same on CipherTensor (tensor.hpp), contiguous storage in either layout
 
 */
 #pragma once
@@ -12,13 +13,47 @@
 #include <tfhe/tfhe.h>
 #include <tfhe/tfhe_io.h>
 #include <cstddef>
+#include "omp_constants.hpp"
+
+class CipherTensor;
+struct ShiftLayer;
+struct ShiftModel;
+class WorkerPool;
 
 void mat_add(LweSample*** sum, LweSample*** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void elem_mult(LweSample*** sum, LweSample*** a, LweSample** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void elem_mult(LweSample*** prod, LweSample** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void elem_mult(LweSample*** prod, LweSample** a, LweSample** b, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void mat_mult(LweSample*** prod, LweSample*** a, LweSample*** b, const int rows, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void mat_mult(LweSample*** prod, LweSample*** a, LweSample*** b, const int M, const int K, const int N, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void mat_mult(LweSample*** prod, int** a, LweSample*** b, const int M, const int K, const int N, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void dot(LweSample* prod, LweSample** a, LweSample** b, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void elem_shift(LweSample** prod, LweSample** a, int* b, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
 void shiftDot(LweSample* result, LweSample** a, int* b, const int cols, const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
-void transpose(LweSample*** transpose, const LweSample*** source, const TFheGateBootstrappingCloudKeySet* ck, size_t size);
+// Dense layer of power-of-two weights (shiftmodel.hpp) on layer.cols inputs of in_bits bits, as ref_shiftLayer.
+// If pool is set, the row sums are evaluated on its workers
+void shiftLayer(LweSample** out, LweSample** in, const int in_bits, const ShiftLayer& layer, const TFheGateBootstrappingCloudKeySet* ck,
+                WorkerPool* pool=NULL);
+// All the layers of a model read with readShiftModel: in has layers[0].cols values of layers[0].bits bits, out has
+// layers.back().rows values of layers.back().bits bits
+void shiftNetwork(LweSample** out, LweSample** in, const ShiftModel& model, const TFheGateBootstrappingCloudKeySet* ck,
+                  WorkerPool* pool=NULL);
+/*
+  out[r] = sum_i weights[r * cols + i] * x[i] / 2^frac_bits + bias[r] (bias may be NULL), plaintext fixed point weights and
+  bias at 2^frac_bits, as ref_matVec. The products are truncated, at most frac_bits units below the exact value.
+  Partial sums of the inputs are shared by all rows
+*/
+void matVec(LweSample** out, const int* weights, const int* bias, LweSample** x, const int rows, const int cols, const int frac_bits,
+            const TFheGateBootstrappingCloudKeySet* ck, const size_t size);
+void transpose(LweSample*** transpose, LweSample*** source, const int rows, const int cols);
+
+/*
+  CipherTensor versions, operands of the same shape and width. mat_add, relu and shiftDot read the bits of either
+  layout in place (mat_add passes circuit::add_batch the bit stride of each operand); the products need element
+  operands and stage bit-plane tensors through an element-major copy
+*/
+void mat_add(CipherTensor& sum, const CipherTensor& a, const CipherTensor& b, const TFheGateBootstrappingCloudKeySet* ck);
+void elem_mult(CipherTensor& prod, const CipherTensor& a, const CipherTensor& b, const TFheGateBootstrappingCloudKeySet* ck);
+void dot(LweSample* result, const CipherTensor& a, const CipherTensor& b, const TFheGateBootstrappingCloudKeySet* ck);
+void shiftDot(LweSample* result, const CipherTensor& a, const int* b, const TFheGateBootstrappingCloudKeySet* ck);
+void relu(CipherTensor& result, const CipherTensor& a, const TFheGateBootstrappingCloudKeySet* ck);
@@ -1,62 +1,137 @@
 /**
   Implements machine learning performance metrics
 */
+#include <algorithm>
+#include <cmath>
 #include "metrics.hpp"
 
 using namespace std;
 
-double calculateRecall(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  double tp = calculateTP(ground_truth_classes, predicted_classes),
-         fn = calculateFN(ground_truth_classes, predicted_classes);
-  return tp / (tp + fn);
+// below this many pairs, a single thread is faster than splitting
+#define METRICS_CHUNK (1 << 16)
+
+ConfusionMatrix::ConfusionMatrix(const int num_classes)
+  : num_classes(num_classes), counts(num_classes * num_classes, 0), num_invalid(0) {
 }
 
-double calculatePrecision(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  double tp = calculateTP(ground_truth_classes, predicted_classes),
-         fp = calculateFP(ground_truth_classes, predicted_classes);
-  return tp / (tp + fp);
+/**
+Every thread fills a private matrix over its chunk of the pairs, then the private matrices are summed
+*/
+void ConfusionMatrix::add(const double* ground_truth_classes, const double* predicted_classes, const size_t n) {
+  const int k = num_classes;
+  #pragma omp parallel num_threads(NUM_THREADS) if(n > METRICS_CHUNK)
+  {
+    vector<long> local(k * k, 0);
+    long local_invalid = 0;
+    #pragma omp for schedule(static) nowait
+    for(long i = 0; i < (long) n; i++) {
+      const long truth = lround(ground_truth_classes[i]),
+                 predicted = lround(predicted_classes[i]);
+      if(truth < 0 || truth >= k || predicted < 0 || predicted >= k)
+        local_invalid++;
+      else
+        local[truth * k + predicted]++;
+    }
+    #pragma omp critical
+    {
+      for(int q = 0; q < k * k; q++) counts[q] += local[q];
+      num_invalid += local_invalid;
+    }
+  }
 }
 
-double calculateAccuracy(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  double tp = calculateTP(ground_truth_classes, predicted_classes),
-         tn = calculateTN(ground_truth_classes, predicted_classes),
-         fn = calculateFN(ground_truth_classes, predicted_classes),
-         fp = calculateFP(ground_truth_classes, predicted_classes);
-  return (tp + tn) / (tp + tn + fp + fn);
+void ConfusionMatrix::add(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  add(ground_truth_classes.data(), predicted_classes.data(), min(ground_truth_classes.size(), predicted_classes.size()));
 }
 
-int calculateTP(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  int tp = 0;
-  for(int i = 0; i < ground_truth_classes.size(); i++) {
-    if(ground_truth_classes[i] == predicted_classes[i] == 1)
-      tp++;
-  }
-  return tp;
+void ConfusionMatrix::merge(const ConfusionMatrix& other) {
+  for(int q = 0; q < num_classes * num_classes; q++) counts[q] += other.counts[q];
+  num_invalid += other.num_invalid;
 }
 
-int calculateTN(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  int tn = 0;
-  for(int i = 0; i < ground_truth_classes.size(); i++) {
-    if(ground_truth_classes[i] == 0 && predicted_classes[i] == 0)
-      tn++;
-  }
-  return tn;
+long ConfusionMatrix::total() const {
+  long sum = 0;
+  for(long c: counts) sum += c;
+  return sum;
 }
 
-int calculateFP(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  int fp = 0;
-  for(int i = 0; i < ground_truth_classes.size(); i++) {
-    if(ground_truth_classes[i] == 0 &&  predicted_classes[i] == 1)
-      fp++;
-  }
-  return fp;
+long ConfusionMatrix::tp(const int c) const {
+  return count(c, c);
 }
 
-int calculateFN(vector<double> ground_truth_classes, vector<double> predicted_classes) {
-  int fn = 0;
-  for(int i = 0; i < ground_truth_classes.size(); i++) {
-    if(ground_truth_classes[i] == 1 && predicted_classes[i] == 0)
-      fn++;
-  }
-  return fn;
+long ConfusionMatrix::fp(const int c) const {
+  long sum = 0;
+  for(int t = 0; t < num_classes; t++) if(t != c) sum += count(t, c);
+  return sum;
+}
+
+long ConfusionMatrix::fn(const int c) const {
+  long sum = 0;
+  for(int p = 0; p < num_classes; p++) if(p != c) sum += count(c, p);
+  return sum;
+}
+
+long ConfusionMatrix::tn(const int c) const {
+  return total() - tp(c) - fp(c) - fn(c);
+}
+
+double ConfusionMatrix::precision(const int c) const {
+  double t = tp(c), f = fp(c);
+  return t / (t + f);
+}
+
+double ConfusionMatrix::recall(const int c) const {
+  double t = tp(c), f = fn(c);
+  return t / (t + f);
+}
+
+double ConfusionMatrix::f1(const int c) const {
+  double t = tp(c);
+  return 2 * t / (2 * t + fp(c) + fn(c));
+}
+
+double ConfusionMatrix::accuracy() const {
+  long correct = 0;
+  for(int c = 0; c < num_classes; c++) correct += tp(c);
+  return (double) correct / total();
+}
+
+double ConfusionMatrix::macroF1() const {
+  double sum = 0;
+  for(int c = 0; c < num_classes; c++) sum += f1(c);
+  return sum / num_classes;
+}
+
+static ConfusionMatrix binaryMatrix(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  ConfusionMatrix matrix(2);
+  matrix.add(ground_truth_classes, predicted_classes);
+  return matrix;
+}
+
+double calculateRecall(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).recall();
+}
+
+double calculatePrecision(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).precision();
+}
+
+double calculateAccuracy(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).accuracy();
+}
+
+int calculateTP(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).tp();
+}
+
+int calculateTN(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).tn();
+}
+
+int calculateFP(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).fp();
+}
+
+int calculateFN(const vector<double>& ground_truth_classes, const vector<double>& predicted_classes) {
+  return binaryMatrix(ground_truth_classes, predicted_classes).fn();
 }
@@ -1,9 +1,50 @@
+#pragma once
+
+#include <cstddef>
 #include <vector>
+#include "omp_constants.hpp"
+
+/**
+  K x K confusion matrix, accumulated in a single pass. Labels are class numbers 0..K-1 stored as doubles
+  (rounded to the nearest integer); pairs with a label outside that range are only counted in invalid().
+  For binary labels, class 1 is the positive class.
+*/
+class ConfusionMatrix {
+  private:
+    int num_classes;
+    std::vector<long> counts;  // counts[truth * num_classes + predicted]
+    long num_invalid;
+
+  public:
+    ConfusionMatrix(const int num_classes=2);
+
+    // n (ground truth, prediction) pairs. Large inputs are split in chunks over the OpenMP threads
+    void add(const double* ground_truth_classes, const double* predicted_classes, const size_t n);
+    void add(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+    void merge(const ConfusionMatrix& other);
+
+    int classes() const { return num_classes; }
+    long count(const int truth, const int predicted) const { return counts[truth * num_classes + predicted]; }
+    long total() const;
+    long invalid() const { return num_invalid; }
+
+    // one-vs-rest counts of class c
+    long tp(const int c=1) const;
+    long fp(const int c=1) const;
+    long fn(const int c=1) const;
+    long tn(const int c=1) const;
+
+    double precision(const int c=1) const;
+    double recall(const int c=1) const;
+    double f1(const int c=1) const;
+    double accuracy() const;
+    double macroF1() const;
+};
 
-double calculateRecall(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
-double calculatePrecision(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
-double calculateAccuracy(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
-int calculateTP(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
-int calculateTN(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
-int calculateFP(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
-int calculateFN(std::vector<double> ground_truth_classes, std::vector<double> predicted_classes);
+double calculateRecall(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+double calculatePrecision(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+double calculateAccuracy(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+int calculateTP(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+int calculateTN(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+int calculateFP(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
+int calculateFN(const std::vector<double>& ground_truth_classes, const std::vector<double>& predicted_classes);
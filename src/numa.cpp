@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <dirent.h>
+#include <omp.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "numa.hpp"
+#include "omp_constants.hpp"
+
+using namespace std;
+
+#define HUGE_PAGE_BYTES (2 << 20)
+
+struct Replica {
+  int node;
+  const TFheGateBootstrappingCloudKeySet* source;
+  TFheGateBootstrappingCloudKeySet* key;
+  KeySwitchTable table;
+  int status;
+};
+
+static vector<Replica> replicas;
+static vector<int> cpu_node;  // node index of every CPU, -1 for CPUs of no node
+
+/* "0-3,8,10-11" */
+static vector<int> parseCpuList(const string& list) {
+  vector<int> cpus;
+  stringstream ss(list);
+  string range;
+  while(getline(ss, range, ',')) {
+    if(range.empty() || range == "\n") continue;
+    int lo, hi;
+    if(sscanf(range.c_str(), "%d-%d", &lo, &hi) == 2) {
+      for(int c = lo; c <= hi; c++) cpus.push_back(c);
+    }
+    else if(sscanf(range.c_str(), "%d", &lo) == 1) {
+      cpus.push_back(lo);
+    }
+  }
+  return cpus;
+}
+
+vector<vector<int>> numaNodes() {
+  vector<int> ids;
+  DIR *dir = opendir("/sys/devices/system/node");
+  if(dir != NULL) {
+    struct dirent *e;
+    int id;
+    while((e = readdir(dir)) != NULL) {
+      if(sscanf(e->d_name, "node%d", &id) == 1) ids.push_back(id);
+    }
+    closedir(dir);
+  }
+  sort(ids.begin(), ids.end());
+  vector<vector<int>> nodes;
+  for(int id: ids) {
+    ifstream in("/sys/devices/system/node/node" + to_string(id) + "/cpulist");
+    string list;
+    getline(in, list);
+    vector<int> cpus = parseCpuList(list);
+    if(!cpus.empty()) nodes.push_back(cpus);
+  }
+  if(nodes.empty()) {
+    vector<int> cpus;
+    for(long c = 0; c < sysconf(_SC_NPROCESSORS_ONLN); c++) cpus.push_back(c);
+    nodes.push_back(cpus);
+  }
+  return nodes;
+}
+
+/* Pins the calling thread to cpus */
+static int pin(const vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for(int c: cpus) {
+    if(c < CPU_SETSIZE) CPU_SET(c, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set);
+}
+
+int bindThreads(const int node) {
+  const vector<vector<int>> nodes = numaNodes();
+  if(node >= (int) nodes.size()) {
+    cout << "Error: no NUMA node " << node << endl;
+    return -1;
+  }
+  int failed = 0;
+  #pragma omp parallel num_threads(NUM_THREADS) reduction(+:failed)
+  {
+    const int t = omp_get_thread_num();
+    failed += pin(nodes[node >= 0 ? node : t % nodes.size()]) < 0;
+  }
+  if(failed > 0) {
+    cout << "Error: failed to pin " << failed << " threads" << endl;
+    return -1;
+  }
+  return 0;
+}
+
+/* Flattens ks into a mapping of 2 MiB pages. Run by a thread of the node the table belongs to: it touches every page first */
+static int buildTable(KeySwitchTable& table, const LweKeySwitchKey* ks, const bool huge_pages) {
+  const int32_t n = ks->n, t = ks->t, base = ks->base, m = ks->out_params->n;
+  const size_t samples = (size_t) n * t * base;
+  table.source = ks;
+  table.bytes = (samples * (m + 1) * sizeof(int32_t) + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+  table.huge = false;
+  void *p = MAP_FAILED;
+  if(huge_pages) {
+    p = mmap(NULL, table.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    table.huge = p != MAP_FAILED;
+  }
+  if(p == MAP_FAILED) {
+    p = mmap(NULL, table.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED) return -1;
+    if(huge_pages) madvise(p, table.bytes, MADV_HUGEPAGE);
+  }
+  table.samples = (int32_t*) p;
+  table.variance = ks->ks[0][0][0].current_variance;
+  for(int32_t i = 0; i < n; i++) {
+    for(int32_t j = 0; j < t; j++) {
+      for(int32_t v = 0; v < base; v++) {
+        const LweSample *src = &ks->ks[i][j][v];
+        int32_t *dst = table.samples + (((size_t) i * t + j) * base + v) * (m + 1);
+        dst[0] = src->b;
+        memcpy(dst + 1, src->a, m * sizeof(int32_t));
+      }
+    }
+  }
+  return 0;
+}
+
+void releaseReplicas() {
+  for(Replica& r: replicas) {
+    if(r.table.samples != NULL) munmap(r.table.samples, r.table.bytes);
+    if(r.key != NULL) {
+      TFheGateBootstrappingParameterSet *params = (TFheGateBootstrappingParameterSet*) r.key->params;
+      delete_gate_bootstrapping_cloud_keyset(r.key);
+      delete_gate_bootstrapping_parameters(params);
+    }
+  }
+  replicas.clear();
+  cpu_node.clear();
+}
+
+int replicateKey(const TFheGateBootstrappingCloudKeySet* ck, const bool huge_pages) {
+  releaseReplicas();
+  char *buf = NULL;
+  size_t len = 0;
+  FILE *stream = open_memstream(&buf, &len);
+  if(stream == NULL) {
+    cout << "Error: failed to serialize the cloud key" << endl;
+    return -1;
+  }
+  export_tfheGateBootstrappingCloudKeySet_toFile(stream, ck);
+  fclose(stream);
+
+  const vector<vector<int>> nodes = numaNodes();
+  replicas.resize(nodes.size());
+  vector<thread> importers;
+  for(size_t k = 0; k < nodes.size(); k++) {
+    Replica& r = replicas[k];
+    r.node = k;
+    r.source = ck;
+    r.key = NULL;
+    r.table.samples = NULL;
+    r.status = 0;
+    importers.push_back(thread([&r, &nodes, buf, len, huge_pages]() {
+      if(pin(nodes[r.node]) < 0) r.status = -1;
+      FILE *in = fmemopen(buf, len, "rb");
+      if(in == NULL) {
+        r.status = -1;
+        return;
+      }
+      r.key = new_tfheGateBootstrappingCloudKeySet_fromFile(in);
+      fclose(in);
+      if(buildTable(r.table, r.key->bkFFT->ks, huge_pages) < 0) r.status = -1;
+    }));
+  }
+  for(thread& t: importers) t.join();
+  free(buf);
+
+  for(size_t k = 0; k < nodes.size(); k++) {
+    if(replicas[k].status < 0) {
+      cout << "Error: failed to place the key replica of node " << k << endl;
+      releaseReplicas();
+      return -1;
+    }
+    for(int c: nodes[k]) {
+      if(c >= (int) cpu_node.size()) cpu_node.resize(c + 1, -1);
+      cpu_node[c] = k;
+    }
+  }
+  return replicas.size();
+}
+
+const TFheGateBootstrappingCloudKeySet* localKey(const TFheGateBootstrappingCloudKeySet* ck) {
+  if(replicas.empty()) return ck;
+  const int cpu = sched_getcpu();
+  if(cpu < 0 || cpu >= (int) cpu_node.size() || cpu_node[cpu] < 0) return ck;
+  const Replica& r = replicas[cpu_node[cpu]];
+  return r.source == ck ? r.key : ck;
+}
+
+const KeySwitchTable* keySwitchTable(const LweKeySwitchKey* ks) {
+  for(const Replica& r: replicas) {
+    if(r.table.source == ks) return &r.table;
+  }
+  return NULL;
+}
@@ -0,0 +1,53 @@
+/**
+    * NUMA-local copies of the cloud key.
+    * Every bootstrap streams the whole FFT bootstrapping key, and every key switch a large part of the key switching
+    * key. On a multi-socket machine, threads on the socket the key was not allocated on read it over the interconnect.
+    * replicateKey() gives every NUMA node its own copy: the key is serialized once and imported again by a thread
+    * pinned to the node, so the kernel places the imported key (and its FFT) in that node's memory on first touch.
+    * The key switching key of each replica is also flattened into one table in 2 MiB pages (hugetlbfs if available,
+    * transparent huge pages otherwise), which keySwitchSlice in bootstrap.cpp reads instead of the scattered samples.
+    * The FFT key layout is private to libtfhe, so it stays in the pages of the allocator.
+    *
+    * bindThreads() pins the OpenMP threads to nodes; the batched gates then use localKey(ck), the replica of the
+    * node the calling thread runs on. Without replicas (or on a single node machine) localKey(ck) is ck.
+    * Set up replicas before running gates and release them after: the replica table is not locked.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Key switching key as one table: sample (i, j, v) at ((i * t + j) * base + v) * (n + 1), b first, then a */
+struct KeySwitchTable {
+  const LweKeySwitchKey* source;  // the key it was built from
+  int32_t* samples;
+  double variance;  // current_variance of the key samples, all equal
+  size_t bytes;  // mapped size
+  bool huge;  // hugetlbfs pages
+};
+
+/** CPUs of every NUMA node, from sysfs. A machine without NUMA information is one node with all CPUs */
+std::vector<std::vector<int>> numaNodes();
+
+/**
+  Pins the OpenMP threads (NUM_THREADS) to NUMA nodes: to node if node >= 0, round robin over the nodes otherwise.
+  Returns -1 if the node does not exist or pinning failed
+*/
+int bindThreads(const int node=-1);
+
+/**
+  Imports a copy of ck on every NUMA node, with a huge page key switching table each (huge_pages false: regular
+  pages). Returns the number of replicas, or -1 on error. Replicas of an earlier call are released first
+*/
+int replicateKey(const TFheGateBootstrappingCloudKeySet* ck, const bool huge_pages=true);
+void releaseReplicas();
+
+/** Replica of ck for the NUMA node of the calling thread, ck itself if there is none */
+const TFheGateBootstrappingCloudKeySet* localKey(const TFheGateBootstrappingCloudKeySet* ck);
+
+/** Flat table of ks, if ks belongs to a replica */
+const KeySwitchTable* keySwitchTable(const LweKeySwitchKey* ks);
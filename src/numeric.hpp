@@ -3,9 +3,16 @@
   * Core functions:
     1. Convert float to fixed point, given precision
     2. Convert fixed point to float, given precision
+    3. Batch versions of both over contiguous buffers
+    4. Scale calibration, per tensor or per channel, from the min/max or a percentile of the magnitudes
 */
 
+#pragma once
+
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <iostream>
 
@@ -13,46 +20,206 @@
 using namespace std;
 
 
-int get_min(int maxbits) {
-  return -pow(2, maxbits-1);
+inline int get_min(int maxbits) {
+  return (int) -(INT64_C(1) << (maxbits-1));
 }
 
-int get_max(int maxbits) {
+inline int get_max(int maxbits) {
   // assumes signed
-  return pow(2, maxbits-1) - 1;
+  return (int) ((INT64_C(1) << (maxbits-1)) - 1);
+}
+
+/** Two's complement wraparound of value to maxbits bits, what CONSTANT does when it keeps the low bits */
+inline int64_t wrap_fixed(int64_t value, int maxbits) {
+  if(maxbits >= 64) return value;
+  const uint64_t mask = (UINT64_C(1) << maxbits) - 1;
+  const uint64_t low = (uint64_t) value & mask;
+  return (low >> (maxbits-1)) & 1 ? (int64_t) (low | ~mask) : (int64_t) low;
 }
 
+/**
+  Truncates flt * factor toward zero, then saturates to the signed maxbits range (clip) or wraps around (!clip).
+  The result is computed in double and int64_t, so T only has to hold maxbits bits
+*/
 template<typename T>
-T float_to_fixed(double flt, int maxbits, int factor, bool clip=true) {
-  int max = get_max(maxbits),
-      min = get_min(maxbits);
-  T fixed = flt * factor;
-  if(fixed > max)
-    fixed = max;
-  else if(fixed < min)
-    fixed = min;
-  return fixed;
+T float_to_fixed(double flt, int maxbits, double factor, bool clip=true) {
+  const double max = get_max(maxbits),
+               min = get_min(maxbits);
+  const double scaled = flt * factor;
+  if(clip)
+    return (T) std::min(std::max(scaled, min), max);
+  return (T) wrap_fixed((int64_t) scaled, maxbits);
 }
 
+/**
+  Batch float_to_fixed over n contiguous values. The bounds are computed once and the loop has no branches,
+  so it vectorizes
+*/
 template<typename T>
-vector<T> float_to_fixed(vector<double> flt, int maxbits, int factor, bool clip=true) {
-  vector<T> fixed;
-  for(double f: flt){
-    fixed.push_back(float_to_fixed<T>(f, maxbits, factor, clip));
+void float_to_fixed(T* fixed, const double* flt, size_t n, int maxbits, double factor, bool clip=true) {
+  const double max = get_max(maxbits),
+               min = get_min(maxbits);
+  if(clip) {
+    #pragma omp simd
+    for(size_t i = 0; i < n; i++) {
+      fixed[i] = (T) std::min(std::max(flt[i] * factor, min), max);
+    }
+  }
+  else {
+    const int shift = 64 - maxbits;
+    #pragma omp simd
+    for(size_t i = 0; i < n; i++) {
+      // sign extension from bit maxbits-1: shift the low bits to the top and back
+      fixed[i] = (T) ((int64_t) ((uint64_t) (int64_t) (flt[i] * factor) << shift) >> shift);
+    }
   }
+}
+
+template<typename T>
+vector<T> float_to_fixed(const vector<double>& flt, int maxbits, double factor, bool clip=true) {
+  vector<T> fixed(flt.size());
+  float_to_fixed<T>(fixed.data(), flt.data(), flt.size(), maxbits, factor, clip);
   return fixed;
 }
 
 
-double fixed_to_float(int fixed, int factor) {
-  return ((float) fixed) / factor;
+inline double fixed_to_float(int64_t fixed, double factor) {
+  return ((double) fixed) / factor;
 }
 
 template<typename T>
-vector<double> fixed_to_float(vector<T> fixed, int factor) {
-  vector<double> flt;
-  for(int f: fixed) {
-    flt.push_back(fixed_to_float(f, factor));
+void fixed_to_float(double* flt, const T* fixed, size_t n, double factor) {
+  const double inv = 1.0 / factor;
+  #pragma omp simd
+  for(size_t i = 0; i < n; i++) {
+    flt[i] = (double) fixed[i] * inv;
   }
+}
+
+template<typename T>
+vector<double> fixed_to_float(const vector<T>& fixed, double factor) {
+  vector<double> flt(fixed.size());
+  fixed_to_float<T>(flt.data(), fixed.data(), fixed.size(), factor);
   return flt;
 }
+
+
+/**
+  Calibrated scale of a tensor or channel: factor maps the calibrated magnitude onto get_max(maxbits).
+  Quantize with float_to_fixed(..., maxbits, factor)
+*/
+struct Calibration {
+  double min;  // smallest value seen
+  double max;  // largest value seen
+  double range;  // magnitude mapped onto the largest fixed point value
+  double factor;
+};
+
+/*
+  Magnitude histogram for percentiles in one pass, without knowing the range beforehand: the bin of |x| is its binary
+  exponent (frexp) and the top CALIBRATION_SUB_BITS bits of its mantissa, so bins are at most 1/2^CALIBRATION_SUB_BITS
+  wide relative to their values. Percentiles are read at the upper edge of their bin, i.e. rounded up
+*/
+#define CALIBRATION_SUB_BITS 4
+#define CALIBRATION_MIN_EXP -64
+#define CALIBRATION_MAX_EXP 64
+#define CALIBRATION_BINS ((CALIBRATION_MAX_EXP - CALIBRATION_MIN_EXP) << CALIBRATION_SUB_BITS)
+
+inline int calibration_bin(double x) {
+  int e;
+  const double m = frexp(fabs(x), &e);  // |x| = m * 2^e, m in [0.5, 1)
+  if(m == 0 || e < CALIBRATION_MIN_EXP) return 0;
+  if(e >= CALIBRATION_MAX_EXP) return CALIBRATION_BINS - 1;
+  return ((e - CALIBRATION_MIN_EXP) << CALIBRATION_SUB_BITS) + (int) ((m - 0.5) * (2 << CALIBRATION_SUB_BITS));
+}
+
+inline double calibration_bin_upper(int bin) {
+  const int e = (bin >> CALIBRATION_SUB_BITS) + CALIBRATION_MIN_EXP,
+            sub = bin & ((1 << CALIBRATION_SUB_BITS) - 1);
+  return ldexp(0.5 + (sub + 1) / (double) (2 << CALIBRATION_SUB_BITS), e);
+}
+
+inline Calibration calibration_finish(double min, double max, const long* histogram, long count, int maxbits, double percentile, bool power_of_two) {
+  Calibration c = {min, max, std::max(fabs(min), fabs(max)), 1};
+  if(histogram != NULL && percentile < 100 && count > 0) {
+    const long target = (long) ceil(percentile / 100 * count);
+    long seen = 0;
+    for(int bin = 0; bin < CALIBRATION_BINS; bin++) {
+      seen += histogram[bin];
+      if(seen >= target) {
+        c.range = std::min(c.range, calibration_bin_upper(bin));
+        break;
+      }
+    }
+  }
+  if(c.range > 0) {
+    c.factor = get_max(maxbits) / c.range;
+    // power of two factors make rescaling a shift
+    if(power_of_two) c.factor = ldexp(1.0, (int) floor(log2(c.factor)));
+  }
+  return c;
+}
+
+/**
+  Per-tensor calibration of n values in one pass. percentile = 100 uses the largest magnitude (min/max), a lower
+  percentile of the magnitudes clips the outliers above it
+*/
+inline Calibration calibrate(const double* data, size_t n, int maxbits, double percentile=100, bool power_of_two=false) {
+  double min = n ? data[0] : 0, max = min;
+  vector<long> histogram(percentile < 100 ? CALIBRATION_BINS : 0, 0);
+  for(size_t i = 0; i < n; i++) {
+    min = std::min(min, data[i]);
+    max = std::max(max, data[i]);
+    if(!histogram.empty()) histogram[calibration_bin(data[i])]++;
+  }
+  return calibration_finish(min, max, histogram.empty() ? NULL : histogram.data(), n, maxbits, percentile, power_of_two);
+}
+
+/**
+  Per-channel calibration of a rows x channels row-major buffer (channel = column), in one pass over the rows
+*/
+inline vector<Calibration> calibrate_channels(const double* data, size_t rows, size_t channels, int maxbits, double percentile=100, bool power_of_two=false) {
+  vector<double> min(data, data + (rows ? channels : 0)), max(min);
+  min.resize(channels, 0);
+  max.resize(channels, 0);
+  vector<long> histogram(percentile < 100 ? channels * CALIBRATION_BINS : 0, 0);
+  for(size_t r = 0; r < rows; r++) {
+    const double* row = data + r * channels;
+    for(size_t c = 0; c < channels; c++) {
+      min[c] = std::min(min[c], row[c]);
+      max[c] = std::max(max[c], row[c]);
+    }
+    if(!histogram.empty()) {
+      for(size_t c = 0; c < channels; c++) histogram[c * CALIBRATION_BINS + calibration_bin(row[c])]++;
+    }
+  }
+  vector<Calibration> calibrations(channels);
+  for(size_t c = 0; c < channels; c++) {
+    calibrations[c] = calibration_finish(min[c], max[c], histogram.empty() ? NULL : &histogram[c * CALIBRATION_BINS], rows, maxbits, percentile, power_of_two);
+  }
+  return calibrations;
+}
+
+/**
+  Quantizes a rows x channels row-major buffer with one calibrated factor per channel
+*/
+template<typename T>
+void float_to_fixed_channels(T* fixed, const double* flt, size_t rows, size_t channels, const vector<Calibration>& calibrations, int maxbits, bool clip=true) {
+  const double max = get_max(maxbits),
+               min = get_min(maxbits);
+  vector<double> factors(channels);
+  for(size_t c = 0; c < channels; c++) factors[c] = calibrations[c].factor;
+  for(size_t r = 0; r < rows; r++) {
+    if(clip) {
+      #pragma omp simd
+      for(size_t c = 0; c < channels; c++) {
+        fixed[r * channels + c] = (T) std::min(std::max(flt[r * channels + c] * factors[c], min), max);
+      }
+    }
+    else {
+      for(size_t c = 0; c < channels; c++) {
+        fixed[r * channels + c] = (T) wrap_fixed((int64_t) (flt[r * channels + c] * factors[c]), maxbits);
+      }
+    }
+  }
+}
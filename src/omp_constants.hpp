@@ -1,2 +1,4 @@
 #define NUM_THREADS 4
 #define OMP_NESTED TRUE
+#define MATRIX_TILE 4
+#define BOOTSTRAP_CHUNK (16 * NUM_THREADS)  // samples blind-rotated together by batchBootstrap
@@ -0,0 +1,101 @@
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "params.hpp"
+
+using namespace std;
+
+const vector<ParameterProfile>& builtinProfiles() {
+  static const vector<ParameterProfile> profiles = {
+    {"fast-insecure", 0, 512, 1, 256, 2, 10, 8, 2, pow(2., -20), pow(2., -30), 0.012467},
+    {"80", 80, 1024, 1, 500, 2, 10, 8, 2, 2.44e-5, 7.18e-9, 0.012467},
+    {"128", 128, 1024, 1, 630, 3, 7, 8, 2, pow(2., -15), pow(2., -25), 0.012467}
+  };
+  return profiles;
+}
+
+/*
+Profile files set any of the fields over the defaults of the 128-bit profile, e.g.
+  name custom
+  N 2048
+  n 700
+*/
+static int readProfile(const string path, ParameterProfile& profile) {
+  ifstream file(path);
+  if(!file.is_open()) {
+    cout << "Error: unknown profile " << path << endl;
+    return -1;
+  }
+  profile = builtinProfiles().back();
+  profile.name = path;
+  profile.security = -1;  // unknown
+  string line;
+  int line_number = 0;
+  while(getline(file, line)) {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    istringstream fields(line);
+    string key;
+    if(!(fields >> key)) continue;
+    bool ok = true;
+    if(key == "name") ok = (bool) (fields >> profile.name);
+    else if(key == "security") ok = (bool) (fields >> profile.security);
+    else if(key == "N") ok = (bool) (fields >> profile.N);
+    else if(key == "k") ok = (bool) (fields >> profile.k);
+    else if(key == "n") ok = (bool) (fields >> profile.n);
+    else if(key == "bk_l") ok = (bool) (fields >> profile.bk_l);
+    else if(key == "bk_Bgbit") ok = (bool) (fields >> profile.bk_Bgbit);
+    else if(key == "ks_t") ok = (bool) (fields >> profile.ks_t);
+    else if(key == "ks_basebit") ok = (bool) (fields >> profile.ks_basebit);
+    else if(key == "ks_stdev") ok = (bool) (fields >> profile.ks_stdev);
+    else if(key == "bk_stdev") ok = (bool) (fields >> profile.bk_stdev);
+    else if(key == "max_stdev") ok = (bool) (fields >> profile.max_stdev);
+    else ok = false;
+    if(!ok) {
+      cout << "Error: " << path << ":" << line_number << ": invalid line" << endl;
+      return -1;
+    }
+  }
+  // N must be a power of two for the FFT, the decompositions have to fit in 32 bits
+  if(profile.N < 2 || (profile.N & (profile.N - 1)) || profile.k < 1 || profile.n < 1
+     || profile.bk_l * profile.bk_Bgbit > 32 || profile.ks_t * profile.ks_basebit > 32) {
+    cout << "Error: " << path << ": invalid parameters" << endl;
+    return -1;
+  }
+  return 0;
+}
+
+int findProfile(const string name, ParameterProfile& profile) {
+  for(const ParameterProfile& p: builtinProfiles()) {
+    if(p.name == name) {
+      profile = p;
+      return 0;
+    }
+  }
+  return readProfile(name, profile);
+}
+
+/*
+Same construction as new_default_gate_bootstrapping_parameters, with the sizes of the profile. The LWE, TRLWE and
+TGSW parameters are owned by the set, like those of the default set
+*/
+TFheGateBootstrappingParameterSet* newParameters(const ParameterProfile& profile) {
+  LweParams *in_out_params = new_LweParams(profile.n, profile.ks_stdev, profile.max_stdev);
+  TLweParams *accum_params = new_TLweParams(profile.N, profile.k, profile.bk_stdev, profile.max_stdev);
+  TGswParams *bk_params = new_TGswParams(profile.bk_l, profile.bk_Bgbit, accum_params);
+  return new TFheGateBootstrappingParameterSet(profile.ks_t, profile.ks_basebit, in_out_params, bk_params);
+}
+
+uint32_t paramsId(const TFheGateBootstrappingParameterSet* params) {
+  const int32_t sizes[] = {params->in_out_params->n, params->tgsw_params->tlwe_params->N, params->tgsw_params->tlwe_params->k,
+                           params->tgsw_params->l, params->tgsw_params->Bgbit, params->ks_t, params->ks_basebit};
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for(int32_t v: sizes) {
+    for(int byte = 0; byte < 4; byte++) {
+      hash = (hash ^ ((v >> (8 * byte)) & 0xff)) * 16777619u;
+    }
+  }
+  return hash != 0 ? hash : 1;
+}
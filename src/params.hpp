@@ -0,0 +1,44 @@
+/**
+    * Registry of named TFHE parameter profiles.
+    * A profile fixes the LWE dimension n, the TRLWE ring (N, k), the bootstrapping key decomposition (Bg = 2^bk_Bgbit,
+    * bk_l levels), the key switching decomposition and the noise of each key. Built-in profiles:
+      - fast-insecure: N = 512, n = 256, for tests and CI only, no security
+      - 80: the TFHE 1.0 gate bootstrapping set, about 80 bits by current estimates
+      - 128: the TFHE 1.1 gate bootstrapping set, about 128 bits
+    * Any other name is read as a profile file of "key value" lines (the field names below, # comments).
+    * paramsId fingerprints the sizes of a parameter set; it is written in wire headers so that samples are never
+    * read with the key of another profile.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ParameterProfile {
+  std::string name;
+  int security;  // estimated bits of security, 0 if insecure
+  int N;  // TRLWE polynomial degree
+  int k;  // TRLWE dimension
+  int n;  // LWE dimension of the gate ciphertexts
+  int bk_l;  // bootstrapping key decomposition levels
+  int bk_Bgbit;  // log2 of the bootstrapping key decomposition base
+  int ks_t;  // key switching decomposition levels
+  int ks_basebit;  // log2 of the key switching base
+  double ks_stdev;  // noise of the key switching key and of fresh LWE samples
+  double bk_stdev;  // noise of the bootstrapping key
+  double max_stdev;  // largest noise that still decrypts a gate output
+};
+
+// The built-in profiles
+const std::vector<ParameterProfile>& builtinProfiles();
+
+// Built-in profile name or profile file. Returns 0 on success, -1 on error
+int findProfile(const std::string name, ParameterProfile& profile);
+
+TFheGateBootstrappingParameterSet* newParameters(const ParameterProfile& profile);
+
+// Fingerprint of the sizes (n, N, k, decompositions) of a parameter set, never 0
+uint32_t paramsId(const TFheGateBootstrappingParameterSet* params);
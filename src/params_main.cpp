@@ -0,0 +1,209 @@
+/*
+Key generation and benchmarks of the TFHE parameter profiles of params.hpp.
+Usage: SHE_params keygen <profile> <secret key out> <cloud key out>
+       SHE_params bench [trials] [profile...]
+       SHE_params numa [trials] [profile]
+bench reports, per profile, the key generation time, the latency of one gate bootstrap and of a batch of
+NUM_THREADS * 4 of them (bootstrap.hpp), the size of the serialized cloud key and of one encrypted bit.
+Without profiles, all built-in profiles are run.
+numa measures, per NUMA node with all threads pinned to it, the bootstraps per second with the cloud key where it
+was generated and with the node's own huge page backed replica (numa.hpp).
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include "bootstrap.hpp"
+#include "numa.hpp"
+#include "params.hpp"
+
+using namespace std;
+
+static double seconds(chrono::steady_clock::time_point since) {
+  return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+}
+
+/* Serialized size of the cloud key, as written by export_tfheGateBootstrappingCloudKeySet_toFile */
+static long cloudKeySize(const TFheGateBootstrappingCloudKeySet* ck) {
+  char *buf = NULL;
+  size_t len = 0;
+  FILE *stream = open_memstream(&buf, &len);
+  if(stream == NULL) return -1;
+  export_tfheGateBootstrappingCloudKeySet_toFile(stream, ck);
+  fclose(stream);
+  free(buf);
+  return len;
+}
+
+static int keygen(const string name, const char* secret_path, const char* cloud_path) {
+  ParameterProfile profile;
+  if(findProfile(name, profile) < 0) return 1;
+  TFheGateBootstrappingParameterSet *params = newParameters(profile);
+  TFheGateBootstrappingSecretKeySet *sk = new_random_gate_bootstrapping_secret_keyset(params);
+  FILE *secret = fopen(secret_path, "wb"), *cloud = fopen(cloud_path, "wb");
+  if(secret == NULL || cloud == NULL) {
+    cout << "Error: failed to open file." << endl;
+    return 1;
+  }
+  export_tfheGateBootstrappingSecretKeySet_toFile(secret, sk);
+  export_tfheGateBootstrappingCloudKeySet_toFile(cloud, &sk->cloud);
+  fclose(secret);
+  fclose(cloud);
+  printf("Profile %s (params %08x): keys written to %s and %s\n", profile.name.c_str(), paramsId(params), secret_path, cloud_path);
+  delete_gate_bootstrapping_secret_keyset(sk);
+  delete_gate_bootstrapping_parameters(params);
+  return 0;
+}
+
+static void bench(const ParameterProfile& profile, const int trials) {
+  TFheGateBootstrappingParameterSet *params = newParameters(profile);
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  TFheGateBootstrappingSecretKeySet *sk = new_random_gate_bootstrapping_secret_keyset(params);
+  const double keygen_s = seconds(start);
+  const TFheGateBootstrappingCloudKeySet *ck = &sk->cloud;
+
+  const int batch = NUM_THREADS * 4;
+  LweSample *a = new_gate_bootstrapping_ciphertext_array(batch, params),
+            *b = new_gate_bootstrapping_ciphertext_array(batch, params),
+            *r = new_gate_bootstrapping_ciphertext_array(batch, params);
+  for(int i = 0; i < batch; i++) {
+    bootsSymEncrypt(&a[i], i & 1, sk);
+    bootsSymEncrypt(&b[i], (i >> 1) & 1, sk);
+  }
+  start = chrono::steady_clock::now();
+  for(int t = 0; t < trials; t++) {
+    bootsNAND(&r[t % batch], &a[t % batch], &b[t % batch], ck);
+  }
+  const double gate_ms = seconds(start) * 1000 / trials;
+  start = chrono::steady_clock::now();
+  for(int t = 0; t < trials; t++) {
+    bootsNAND_batch(r, a, b, batch, ck);
+  }
+  const double batch_ms = seconds(start) * 1000 / trials;
+  int errors = 0;
+  for(int i = 0; i < batch; i++) {
+    errors += bootsSymDecrypt(&r[i], sk) != !((i & 1) && ((i >> 1) & 1));
+  }
+
+  const long key_bytes = cloudKeySize(ck);
+  const long bit_bytes = (params->in_out_params->n + 1) * sizeof(int32_t);  // wire.hpp sample
+  const string security = profile.security < 0 ? "?" : to_string(profile.security);
+  printf("%-16s %8s %10.2f %10.2f %14.2f %12.1f %8ld %s\n", profile.name.c_str(), security.c_str(), keygen_s, gate_ms,
+         batch_ms / batch, key_bytes / 1048576.0, bit_bytes, errors ? "DECRYPTION ERRORS" : "");
+
+  delete_gate_bootstrapping_ciphertext_array(batch, a);
+  delete_gate_bootstrapping_ciphertext_array(batch, b);
+  delete_gate_bootstrapping_ciphertext_array(batch, r);
+  delete_gate_bootstrapping_secret_keyset(sk);
+  delete_gate_bootstrapping_parameters(params);
+}
+
+/* Bootstraps per second of trials batches of NUM_THREADS * 4 NANDs */
+static double gateRate(LweSample* r, const LweSample* a, const LweSample* b, const int batch, const int trials,
+                       const TFheGateBootstrappingCloudKeySet* ck) {
+  bootsNAND_batch(r, a, b, batch, ck);  // warm up
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for(int t = 0; t < trials; t++) {
+    bootsNAND_batch(r, a, b, batch, ck);
+  }
+  return trials * batch / seconds(start);
+}
+
+static int benchNuma(const ParameterProfile& profile, const int trials) {
+  TFheGateBootstrappingParameterSet *params = newParameters(profile);
+  TFheGateBootstrappingSecretKeySet *sk = new_random_gate_bootstrapping_secret_keyset(params);
+  const TFheGateBootstrappingCloudKeySet *ck = &sk->cloud;
+  const int batch = NUM_THREADS * 4;
+  LweSample *a = new_gate_bootstrapping_ciphertext_array(batch, params),
+            *b = new_gate_bootstrapping_ciphertext_array(batch, params),
+            *r = new_gate_bootstrapping_ciphertext_array(batch, params);
+  for(int i = 0; i < batch; i++) {
+    bootsSymEncrypt(&a[i], i & 1, sk);
+    bootsSymEncrypt(&b[i], (i >> 1) & 1, sk);
+  }
+
+  const int nodes = numaNodes().size();
+  vector<double> shared(nodes), local(nodes);
+  for(int node = 0; node < nodes; node++) {
+    if(bindThreads(node) < 0) return 1;
+    shared[node] = gateRate(r, a, b, batch, trials, ck);
+  }
+  if(replicateKey(ck) < 0) return 1;
+  for(int node = 0; node < nodes; node++) {
+    bindThreads(node);
+    local[node] = gateRate(r, a, b, batch, trials, ck);
+  }
+  int errors = 0;
+  for(int i = 0; i < batch; i++) {
+    errors += bootsSymDecrypt(&r[i], sk) != !((i & 1) && ((i >> 1) & 1));
+  }
+  releaseReplicas();
+
+  printf("Profile %s, %d threads, %d NUMA nodes\n", profile.name.c_str(), NUM_THREADS, nodes);
+  printf("%5s %16s %16s %8s\n", "node", "shared key gt/s", "local key gt/s", "gain");
+  for(int node = 0; node < nodes; node++) {
+    printf("%5d %16.1f %16.1f %7.2fx\n", node, shared[node], local[node], local[node] / shared[node]);
+  }
+  if(errors) printf("DECRYPTION ERRORS\n");
+
+  delete_gate_bootstrapping_ciphertext_array(batch, a);
+  delete_gate_bootstrapping_ciphertext_array(batch, b);
+  delete_gate_bootstrapping_ciphertext_array(batch, r);
+  delete_gate_bootstrapping_secret_keyset(sk);
+  delete_gate_bootstrapping_parameters(params);
+  return errors ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const string usage = string("Usage: ") + argv[0] + " keygen <profile> <secret key out> <cloud key out>\n"
+                       + "       " + argv[0] + " bench [trials] [profile...]\n"
+                       + "       " + argv[0] + " numa [trials] [profile]";
+  if(argc < 2) {
+    cout << usage << endl;
+    return 1;
+  }
+  const string mode = argv[1];
+  if(mode == "keygen") {
+    if(argc != 5) {
+      cout << usage << endl;
+      return 1;
+    }
+    return keygen(argv[2], argv[3], argv[4]);
+  }
+  if(mode == "numa") {
+    ParameterProfile profile;
+    if(findProfile(argc > 3 ? argv[3] : "80", profile) < 0) return 1;
+    const int trials = argc > 2 ? atoi(argv[2]) : 20;
+    if(trials < 1) {
+      cout << "Error: trials must be positive" << endl;
+      return 1;
+    }
+    return benchNuma(profile, trials);
+  }
+  if(mode != "bench") {
+    cout << usage << endl;
+    return 1;
+  }
+  const int trials = argc > 2 ? atoi(argv[2]) : 20;
+  vector<ParameterProfile> profiles;
+  for(int i = 3; i < argc; i++) {
+    ParameterProfile profile;
+    if(findProfile(argv[i], profile) < 0) return 1;
+    profiles.push_back(profile);
+  }
+  if(profiles.empty()) profiles = builtinProfiles();
+  if(trials < 1) {
+    cout << "Error: trials must be positive" << endl;
+    return 1;
+  }
+
+  printf("%-16s %8s %10s %10s %14s %12s %8s\n", "profile", "security", "keygen s", "gate ms", "batch ms/gate", "cloud key MB", "bit B");
+  for(const ParameterProfile& profile: profiles) {
+    bench(profile, trials);
+  }
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*
+Converts a float model to the power-of-two model file of shiftmodel.hpp, for shiftLayer.
+Usage: SHE_quantize <model out> <calibration csv, label in last column> <frac_bits> <terms, 1 or 2> <layer> [layer...]
+A layer is weights.csv[:bias.csv[:bn.csv]]: weights is rows (outputs) x cols (inputs), bias one row, bn four rows
+(gamma, beta, mean, var) folded into the weights and bias. Every layer but the last has a ReLU.
+The width of each layer is the smallest that holds its inputs and outputs over the calibration data (plus a guard bit).
+Prints the weight error per layer and the accuracy of the float and quantized models: a single output is
+classified by its sign, several by their argmax.
+*/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "io.hpp"
+#include "metrics.hpp"
+#include "numeric.hpp"
+#include "reference.hpp"
+#include "shiftmodel.hpp"
+
+using namespace std;
+
+struct FloatLayer {
+  vector<vector<double>> weights;
+  vector<double> bias;
+};
+
+static int loadLayer(const string spec, FloatLayer& layer) {
+  vector<string> paths;
+  size_t start = 0, end;
+  while((end = spec.find(':', start)) != string::npos) {
+    paths.push_back(spec.substr(start, end - start));
+    start = end + 1;
+  }
+  paths.push_back(spec.substr(start));
+  layer.weights = readFile(paths[0]);
+  if(layer.weights.empty()) return -1;
+  layer.bias.assign(layer.weights.size(), 0);
+  if(paths.size() > 1) {
+    vector<vector<double>> bias = readFile(paths[1]);
+    if(bias.empty() || bias[0].size() != layer.weights.size()) {
+      cout << "Error: " << paths[1] << " does not have one bias per output." << endl;
+      return -1;
+    }
+    layer.bias = bias[0];
+  }
+  if(paths.size() > 2) {
+    vector<vector<double>> bn = readFile(paths[2]);
+    if(bn.size() != 4 || bn[0].size() != layer.weights.size()) {
+      cout << "Error: " << paths[2] << " should have rows gamma, beta, mean, var of one value per output." << endl;
+      return -1;
+    }
+    foldBatchNorm(layer.weights, layer.bias, bn[0], bn[1], bn[2], bn[3]);
+  }
+  return 0;
+}
+
+/* 1 sign bit, the integer bits of max_abs, frac_bits and a guard bit for the quantization error */
+static int widthFor(const double max_abs, const int frac_bits) {
+  int int_bits = 0;
+  while(ldexp(1.0, int_bits) <= max_abs) int_bits++;
+  return min(32, max(2, 2 + int_bits + frac_bits));
+}
+
+static double predictClass(const vector<double>& out) {
+  if(out.size() == 1) return out[0] >= 0;
+  int best = 0;
+  for(size_t c = 1; c < out.size(); c++) if(out[c] > out[best]) best = c;
+  return best;
+}
+
+static double accuracy(const vector<double>& truth, const vector<double>& predicted, const int classes) {
+  ConfusionMatrix matrix(classes);
+  matrix.add(truth, predicted);
+  return matrix.accuracy();
+}
+
+int main(int argc, char** argv) {
+  if(argc < 6) {
+    cout << "Usage: " << argv[0] << " <model out> <calibration csv, label in last column> <frac_bits> <terms, 1 or 2> <layer> [layer...]" << endl;
+    cout << "  layer: weights.csv[:bias.csv[:bn.csv]]" << endl;
+    return 1;
+  }
+  const int frac_bits = atoi(argv[3]), terms = atoi(argv[4]);
+  if(frac_bits < 0 || frac_bits > 24 || terms < 1 || terms > 2) {
+    cout << "Error: frac_bits must be in 0..24 and terms 1 or 2" << endl;
+    return 1;
+  }
+  vector<vector<double>> data = readFile(argv[2]);
+  if(data.empty()) return 1;
+  vector<double> labels;
+  for(vector<double>& row: data) {
+    labels.push_back(row.back());
+    row.pop_back();
+  }
+  vector<FloatLayer> layers(argc - 5);
+  for(size_t l = 0; l < layers.size(); l++) {
+    if(loadLayer(argv[5 + l], layers[l]) < 0) return 1;
+    const size_t cols = l == 0 ? data[0].size() : layers[l-1].weights.size();
+    for(const vector<double>& row: layers[l].weights) {
+      if(row.size() != cols) {
+        cout << "Error: layer " << l << " expects " << row.size() << " inputs, has " << cols << endl;
+        return 1;
+      }
+    }
+  }
+
+  // float model: calibration of the widths, reference predictions
+  vector<double> max_abs(layers.size(), 0), float_pred;
+  for(const vector<double>& x: data) {
+    vector<double> h = x;
+    for(size_t l = 0; l < layers.size(); l++) {
+      for(double v: h) max_abs[l] = max(max_abs[l], fabs(v));
+      vector<double> next(layers[l].weights.size());
+      for(size_t r = 0; r < next.size(); r++) {
+        double acc = layers[l].bias[r];
+        for(size_t j = 0; j < h.size(); j++) acc += layers[l].weights[r][j] * h[j];
+        max_abs[l] = max(max_abs[l], fabs(acc));
+        next[r] = l + 1 < layers.size() ? max(acc, 0.0) : acc;
+      }
+      h = next;
+    }
+    float_pred.push_back(predictClass(h));
+  }
+
+  ShiftModel model;
+  model.frac_bits = frac_bits;
+  printf("layer  rows  cols  bits  mean |w - q|  max |w - q|\n");
+  for(size_t l = 0; l < layers.size(); l++) {
+    ShiftLayer q;
+    q.rows = layers[l].weights.size();
+    q.cols = layers[l].weights[0].size();
+    q.terms = terms;
+    q.bits = widthFor(max_abs[l], frac_bits);
+    q.relu = l + 1 < layers.size();
+    q.signs.resize(q.rows * q.cols * terms);
+    q.exps.resize(q.rows * q.cols * terms);
+    double err_sum = 0, err_max = 0;
+    for(int r = 0; r < q.rows; r++) {
+      for(int j = 0; j < q.cols; j++) {
+        const int at = (r * q.cols + j) * terms;
+        const double w = layers[l].weights[r][j];
+        const double err = fabs(w - quantizePow2(w, terms, -(q.bits - 1), q.bits - 1, &q.signs[at], &q.exps[at]));
+        err_sum += err;
+        err_max = max(err_max, err);
+      }
+      q.bias.push_back(float_to_fixed<int>(layers[l].bias[r], q.bits, 1 << frac_bits));
+    }
+    printf("%5zu %5d %5d %5d %13.6f %12.6f\n", l, q.rows, q.cols, q.bits, err_sum / (q.rows * q.cols), err_max);
+    model.layers.push_back(q);
+  }
+
+  // quantized model, bit exact with the encrypted shiftLayer
+  vector<double> quant_pred;
+  for(const vector<double>& x: data) {
+    vector<int32_t> h = float_to_fixed<int32_t>(x, model.layers[0].bits, 1 << frac_bits);
+    for(const ShiftLayer& q: model.layers) {
+      vector<int32_t> next(q.rows);
+      ref_shiftLayer(next.data(), h.data(), q.rows, q.cols, q.terms, q.signs.data(), q.exps.data(), q.bias.data(), q.bits, q.relu);
+      h = next;
+    }
+    vector<double> out(h.begin(), h.end());
+    quant_pred.push_back(predictClass(out));
+  }
+
+  const int classes = max(2, model.layers.back().rows);
+  const double float_acc = accuracy(labels, float_pred, classes), quant_acc = accuracy(labels, quant_pred, classes),
+               agreement = accuracy(float_pred, quant_pred, classes);
+  printf("Float accuracy %.4f, quantized accuracy %.4f (loss %.4f), agreement %.4f\n", float_acc, quant_acc, float_acc - quant_acc, agreement);
+  if(writeShiftModel(model, argv[1]) < 0) return 1;
+  printf("Model written to %s\n", argv[1]);
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "reference.hpp"
+#include "circuits.hpp"
+
+int32_t ref_wrap(int64_t value, const int bits) {
+  const int shift = 64 - bits;
+  return (int32_t) ((int64_t) ((uint64_t) value << shift) >> shift);
+}
+
+/* Sums the same window of Baugh-Wooley partial product bits and the same constant as fixed_partial_products */
+int32_t ref_mult_fixed(const int32_t a, const int32_t b, const int frac_bits, const int bits) {
+  const int n = bits, lo = std::max(0, frac_bits - circuit::mult_fixed_guard(bits)), hi = frac_bits + n, w = hi - lo;
+  uint64_t sum = 0;
+  double dropped = 0;
+  for(int j = 0; j < n; j++) {
+    for(int i = 0; i < n && i + j < hi; i++) {
+      const bool nand = (i == n-1) != (j == n-1);
+      if(i + j < lo) {
+        dropped += ldexp(nand ? 0.75 : 0.25, i + j - lo);
+        continue;
+      }
+      const bool bit = ((a >> i) & 1) && ((b >> j) & 1);
+      if(bit != nand) sum += UINT64_C(1) << (i + j - lo);
+    }
+  }
+  sum += (uint64_t) llround(dropped);
+  if(frac_bits > 0) sum += UINT64_C(1) << (frac_bits - 1 - lo);
+  if(n - lo < w) sum += UINT64_C(1) << (n - lo);
+  if(2*n - 1 - lo < w) sum += UINT64_C(1) << (2*n - 1 - lo);
+  return ref_wrap((int64_t) (sum >> (frac_bits - lo)), bits);
+}
+
+/* x shifted by s as elem_shift on a bits-wide value, wrapped */
+static inline int32_t shift_wrap(int32_t x, const int s, const int bits) {
+  const uint32_t mask = bits == 32 ? 0xffffffffu : (1u << bits) - 1;
+  if(s >= bits || -s >= bits) return 0;
+  if(s >= 0) return ref_wrap((int64_t) ((uint32_t) x << s), bits);
+  return ref_wrap(((uint32_t) x & mask) >> -s, bits);
+}
+
+void ref_shiftDot(int32_t* out, const int32_t* X, const int rows, const int cols, const int* shifts, const int bits) {
+  // accumulate in uint32_t: addition modulo 2^32, reduced to bits at the end
+  std::vector<uint32_t> acc(rows, 0);
+  for(int j = 0; j < cols; j++) {
+    const int s = shifts[j];
+    #pragma omp simd
+    for(int r = 0; r < rows; r++) {
+      acc[r] += (uint32_t) shift_wrap(X[(size_t) r * cols + j], s, bits);
+    }
+  }
+  for(int r = 0; r < rows; r++) out[r] = ref_wrap(acc[r], bits);
+}
+
+void ref_conv2d(int32_t* out, const int32_t* in, const int channels, const int height, const int width,
+                const int* shifts, const int filters, const int kernel, const int stride, const int bits) {
+  const int out_h = (height - kernel) / stride + 1,
+            out_w = (width - kernel) / stride + 1;
+  std::vector<uint32_t> acc(out_w);
+  for(int f = 0; f < filters; f++) {
+    for(int y = 0; y < out_h; y++) {
+      std::fill(acc.begin(), acc.end(), 0);
+      for(int c = 0; c < channels; c++) {
+        for(int ky = 0; ky < kernel; ky++) {
+          const int32_t* row = in + ((size_t) c * height + y * stride + ky) * width;
+          for(int kx = 0; kx < kernel; kx++) {
+            const int s = shifts[((f * channels + c) * kernel + ky) * kernel + kx];
+            #pragma omp simd
+            for(int x = 0; x < out_w; x++) {
+              acc[x] += (uint32_t) shift_wrap(row[x * stride + kx], s, bits);
+            }
+          }
+        }
+      }
+      for(int x = 0; x < out_w; x++) out[((size_t) f * out_h + y) * out_w + x] = ref_wrap(acc[x], bits);
+    }
+  }
+}
+
+void ref_maxpool(int32_t* out, const int32_t* in, const int channels, const int height, const int width,
+                 const int pool, const int stride, const int bits) {
+  const int out_h = (height - pool) / stride + 1,
+            out_w = (width - pool) / stride + 1;
+  for(int c = 0; c < channels; c++) {
+    for(int y = 0; y < out_h; y++) {
+      int32_t* o = out + ((size_t) c * out_h + y) * out_w;
+      for(int x = 0; x < out_w; x++) o[x] = ref_wrap(in[((size_t) c * height + y * stride) * width + x * stride], bits);
+      for(int py = 0; py < pool; py++) {
+        const int32_t* row = in + ((size_t) c * height + y * stride + py) * width;
+        for(int px = 0; px < pool; px++) {
+          #pragma omp simd
+          for(int x = 0; x < out_w; x++) {
+            const int32_t v = ref_wrap(row[x * stride + px], bits);
+            o[x] = v > o[x] ? v : o[x];
+          }
+        }
+      }
+    }
+  }
+}
+
+void ref_relu(int32_t* out, const int32_t* in, const size_t n, const int bits) {
+  #pragma omp simd
+  for(size_t i = 0; i < n; i++) {
+    const int32_t v = ref_wrap(in[i], bits);
+    out[i] = v > 0 ? v : 0;
+  }
+}
+
+void ref_shiftLayer(int32_t* out, const int32_t* in, const int rows, const int cols, const int terms, const int* signs,
+                    const int* exps, const int* bias, const int bits, const bool relu) {
+  std::vector<int32_t> x(cols);
+  for(int j = 0; j < cols; j++) x[j] = ref_wrap(in[j], bits);
+  for(int r = 0; r < rows; r++) {
+    uint32_t acc = bias[r];
+    for(int q = r * cols * terms; q < (r + 1) * cols * terms; q++) {
+      const int32_t v = x[(q / terms) % cols], e = exps[q];
+      const uint32_t term = e >= 0 ? (uint32_t) v << e : (uint32_t) (v >> -e);
+      acc += signs[q] > 0 ? term : signs[q] < 0 ? -term : 0;
+    }
+    const int32_t y = ref_wrap(acc, bits);
+    out[r] = relu && y < 0 ? 0 : y;
+  }
+}
+
+void ref_matVec(int32_t* out, const int* weights, const int* bias, const int32_t* in, const int rows, const int cols,
+                const int frac_bits, const int bits) {
+  for(int r = 0; r < rows; r++) {
+    uint32_t acc = bias != NULL ? bias[r] : 0;
+    for(int j = 0; j < bits; j++) {
+      uint32_t d = 0;
+      for(int i = 0; i < cols; i++) {
+        const int w = weights[(size_t) r * cols + i];
+        const uint32_t m = w < 0 ? -(uint32_t) w : w;
+        if((m >> j) & 1) d += w < 0 ? -(uint32_t) in[i] : (uint32_t) in[i];
+      }
+      const int32_t v = ref_wrap(d, bits), s = j - frac_bits;
+      acc += s >= 0 ? (uint32_t) v << s : (uint32_t) (v >> std::min(-s, 31));
+    }
+    out[r] = ref_wrap(acc, bits);
+  }
+}
+
+void ref_logistic(int32_t* out, const int32_t* X, const int rows, const int dim, const int32_t* weights,
+                  const int32_t* coefs, const int degree, const int frac_bits, const int bits) {
+  // add and mult modulo 2^32 agree with the circuits modulo 2^bits
+  std::vector<uint32_t> pre(rows, 0);
+  for(int j = 0; j < dim; j++) {
+    const uint32_t w = weights[j];
+    #pragma omp simd
+    for(int r = 0; r < rows; r++) {
+      pre[r] += w * (uint32_t) X[(size_t) r * dim + j];
+    }
+  }
+  for(int r = 0; r < rows; r++) {
+    const int32_t p = ref_wrap(pre[r], bits);
+    int32_t v = ref_wrap(coefs[degree], bits);
+    for(int i = degree - 1; i >= 0; i--) {
+      v = ref_wrap((int64_t) coefs[i] + ref_mult_fixed(v, p, frac_bits, bits), bits);
+    }
+    out[r] = v;
+  }
+}
+
+VerifyReport verify_tensor(const char* name, const int32_t* expected, const int32_t* actual, const size_t n, const int bits, const int max_print) {
+  VerifyReport report = {n, 0, n};
+  for(size_t i = 0; i < n; i++) {
+    const int32_t e = ref_wrap(expected[i], bits), a = ref_wrap(actual[i], bits);
+    if(e == a) continue;
+    if(report.mismatches == 0) report.first_mismatch = i;
+    if(report.mismatches < (size_t) max_print) printf("%s[%zu]: decrypted %d, expected %d\n", name, i, a, e);
+    report.mismatches++;
+  }
+  if(report.mismatches == 0) printf("%s: %zu values verified\n", name, n);
+  else printf("%s: %zu of %zu values differ\n", name, report.mismatches, n);
+  return report;
+}
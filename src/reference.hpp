@@ -0,0 +1,69 @@
+/**
+    * Plaintext reference kernels with the bit-exact integer semantics of the encrypted circuits, and bulk verification.
+    * Values are int32_t holding `bits`-bit two's complement numbers (bits <= 32). As in alu.cpp, add and mult wrap
+    * around modulo 2^bits, left shifts drop the top bits and right shifts fill the top bits with zeros (a logical shift
+    * of the bits-wide pattern). Kernels loop over samples / output positions innermost, so they vectorize.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Two's complement wraparound to bits bits
+int32_t ref_wrap(int64_t value, const int bits);
+
+// mult_fixed: a * b / 2^frac_bits with the truncated, rounded multiplier of circuits.hpp (mult_fixed_guard guard columns)
+int32_t ref_mult_fixed(const int32_t a, const int32_t b, const int frac_bits, const int bits);
+
+// out[r] = shiftDot(X[r], shifts) for rows samples of cols features (row-major), as shiftDot in matrix.cpp
+void ref_shiftDot(int32_t* out, const int32_t* X, const int rows, const int cols, const int* shifts, const int bits);
+
+/*
+  Convolution with shift weights (x << s for s > 0, x >> -s for s < 0), valid padding.
+  in is [channels][height][width], shifts is [filters][channels][kernel][kernel], out is [filters][out_h][out_w] with
+  out_h = (height - kernel) / stride + 1, same for out_w. Every output is the shiftDot of its patch
+*/
+void ref_conv2d(int32_t* out, const int32_t* in, const int channels, const int height, const int width,
+                const int* shifts, const int filters, const int kernel, const int stride, const int bits);
+
+// Max pooling of [channels][height][width], signed comparison, valid padding
+void ref_maxpool(int32_t* out, const int32_t* in, const int channels, const int height, const int width,
+                 const int pool, const int stride, const int bits);
+
+void ref_relu(int32_t* out, const int32_t* in, const size_t n, const int bits);
+
+/*
+  Dense layer of power-of-two weights (shiftmodel.hpp), as shiftLayer in matrix.cpp: out[r] is the sum over inputs j
+  and terms t of signs * (in[j] shifted by exps), plus bias[r], at bits bits, then ReLU if relu. Unlike shiftDot, right
+  shifts are arithmetic, so negative activations keep their sign. Inputs are first wrapped to bits bits; |exps| < bits
+*/
+void ref_shiftLayer(int32_t* out, const int32_t* in, const int rows, const int cols, const int terms, const int* signs,
+                    const int* exps, const int* bias, const int bits, const bool relu);
+
+/*
+  Plaintext weights times an encrypted vector, as circuit::matVec: out[r] is the sum over bit planes j of the
+  weight magnitudes of D_rj shifted by j - frac_bits (arithmetic right shift for j < frac_bits), plus bias[r] (may be
+  NULL), at bits bits. D_rj is the sum of sign(weights[r][i]) * in[i] over the i whose |weight| has bit j set
+*/
+void ref_matVec(int32_t* out, const int* weights, const int* bias, const int32_t* in, const int rows, const int cols,
+                const int frac_bits, const int bits);
+
+/*
+  ApproxLogRegression::predict: preactivation dot(weights, X[r]) then Horner's algorithm over coefs[0..degree]
+  with mult_fixed at frac_bits, all at bits bits. weights and coefs are the fixed point values given to CONSTANT
+*/
+void ref_logistic(int32_t* out, const int32_t* X, const int rows, const int dim, const int32_t* weights,
+                  const int32_t* coefs, const int degree, const int frac_bits, const int bits);
+
+struct VerifyReport {
+  size_t checked;
+  size_t mismatches;
+  size_t first_mismatch;  // index of the first mismatch, checked when there is none
+};
+
+/*
+  Compares n decrypted values with the references, both taken modulo 2^bits. Prints up to max_print mismatches
+  and a summary line under name
+*/
+VerifyReport verify_tensor(const char* name, const int32_t* expected, const int32_t* actual, const size_t n, const int bits, const int max_print=10);
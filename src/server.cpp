@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.hpp"
+#include "wire.hpp"
+#include "params.hpp"
+
+using namespace std;
+
+#define LATENCY_WINDOW 10000
+
+InferenceServer::InferenceServer(ApproxLogRegression* model, const TFheGateBootstrappingCloudKeySet* ck, ServerConfig config)
+  : model(model), ck(ck), config(config), latency_next(0), completed(0), batches(0), start(chrono::steady_clock::now()) {
+}
+
+static int listenUnix(string path) {
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+  unlink(path.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+    if(fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int listenTcp(int port) {
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // localhost only
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  if(fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if(fd < 0 || bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+    if(fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int InferenceServer::run() {
+  vector<struct pollfd> listeners;
+  if(!config.unix_path.empty()) {
+    int fd = listenUnix(config.unix_path);
+    if(fd < 0) cout << "Error: failed to listen on " << config.unix_path << endl;
+    else listeners.push_back({fd, POLLIN, 0});
+  }
+  if(config.tcp_port > 0) {
+    int fd = listenTcp(config.tcp_port);
+    if(fd < 0) cout << "Error: failed to listen on port " << config.tcp_port << endl;
+    else listeners.push_back({fd, POLLIN, 0});
+  }
+  if(listeners.empty()) return -1;
+
+  thread(&InferenceServer::batchLoop, this).detach();
+  while(poll(listeners.data(), listeners.size(), -1) >= 0) {
+    for(struct pollfd& l: listeners) {
+      if(!(l.revents & POLLIN)) continue;
+      int fd = accept(l.fd, NULL, NULL);
+      if(fd >= 0) thread(&InferenceServer::serveConnection, this, fd).detach();
+    }
+  }
+  for(struct pollfd& l: listeners) close(l.fd);
+  return 0;
+}
+
+/*
+One thread per client reads requests and queues them; the batch thread answers them.
+The connection is closed once the client hangs up and none of its requests is pending
+*/
+void InferenceServer::serveConnection(int fd) {
+  const int dim = model->getDim();
+  const size_t size = model->getSize();
+  Connection *conn = new Connection;
+  conn->fd = fd;
+  conn->pending = 0;
+  WireHeader header;
+  while(readHeader(fd, header) == 0) {
+    if(header.op == SERVER_STATS) {
+      string text = stats();
+      lock_guard<mutex> guard(conn->write_lock);
+      writeHeader(fd, SERVER_STATS, text.size(), 0);
+      writeAll(fd, text.data(), text.size());
+      continue;
+    }
+    if((header.op & ~WIRE_SEEDED) != SERVER_PREDICT || (int) header.count != dim || header.size != size || header.params != paramsId(ck->params)) {
+      lock_guard<mutex> guard(conn->write_lock);
+      writeHeader(fd, SERVER_ERROR, 0, 0);
+      break;
+    }
+    LweSample **X = new LweSample*[dim];
+    int status = 0;
+    SeededSamples seeded;
+    if(header.op & WIRE_SEEDED) status = readSeededSamples(fd, seeded, dim * size);
+    for(int i = 0; i < dim; i++) {
+      X[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+      if(status < 0) continue;
+      if(header.op & WIRE_SEEDED)
+        expandSeeded(X[i], seeded, i * size, size, ck->params->in_out_params);
+      else
+        status = readSamples(fd, X[i], size, ck->params->in_out_params);
+    }
+    if(status < 0) {
+      for(int i = 0; i < dim; i++) delete_gate_bootstrapping_ciphertext_array(size, X[i]);
+      delete[] X;
+      break;
+    }
+    Request request = {conn, X, chrono::steady_clock::now()};
+    {
+      lock_guard<mutex> guard(queue_lock);
+      queue.push_back(request);
+      conn->pending++;
+    }
+    queue_ready.notify_one();
+  }
+  {
+    unique_lock<mutex> guard(queue_lock);
+    drained.wait(guard, [conn] { return conn->pending == 0; });
+  }
+  close(fd);
+  delete conn;
+}
+
+void InferenceServer::batchLoop() {
+  const int dim = model->getDim();
+  const size_t size = model->getSize();
+  while(true) {
+    vector<Request> batch;
+    {
+      unique_lock<mutex> guard(queue_lock);
+      queue_ready.wait(guard, [this] { return !queue.empty(); });
+      // give concurrent clients max_wait_ms to join the batch
+      queue_ready.wait_for(guard, chrono::milliseconds(config.max_wait_ms),
+                           [this] { return (int) queue.size() >= config.max_batch; });
+      const int n = min((int) queue.size(), config.max_batch);
+      batch.assign(queue.begin(), queue.begin() + n);
+      queue.erase(queue.begin(), queue.begin() + n);
+    }
+
+    const int count = batch.size();
+    LweSample ***X = new LweSample**[count];
+    LweSample **y = new LweSample*[count];
+    for(int s = 0; s < count; s++) {
+      X[s] = batch[s].X;
+      y[s] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    }
+    model->predict_batch(y, X, count);
+
+    for(int s = 0; s < count; s++) {
+      Request& r = batch[s];
+      {
+        lock_guard<mutex> guard(r.conn->write_lock);
+        writeHeader(r.conn->fd, SERVER_RESULT, 1, size, paramsId(ck->params));
+        writeSamples(r.conn->fd, y[s], size, ck->params->in_out_params);
+      }
+      record(chrono::duration<double, milli>(chrono::steady_clock::now() - r.arrival).count());
+      for(int i = 0; i < dim; i++) delete_gate_bootstrapping_ciphertext_array(size, r.X[i]);
+      delete[] r.X;
+      delete_gate_bootstrapping_ciphertext_array(size, y[s]);
+      {
+        lock_guard<mutex> guard(queue_lock);
+        r.conn->pending--;
+      }
+      drained.notify_all();
+    }
+    delete[] X;
+    delete[] y;
+    {
+      lock_guard<mutex> guard(stats_lock);
+      batches++;
+    }
+  }
+}
+
+void InferenceServer::record(double latency_ms) {
+  lock_guard<mutex> guard(stats_lock);
+  if(latencies_ms.size() < LATENCY_WINDOW) latencies_ms.push_back(latency_ms);
+  else latencies_ms[latency_next] = latency_ms;
+  latency_next = (latency_next + 1) % LATENCY_WINDOW;
+  completed++;
+}
+
+string InferenceServer::stats() {
+  size_t depth;
+  {
+    lock_guard<mutex> guard(queue_lock);
+    depth = queue.size();
+  }
+  lock_guard<mutex> guard(stats_lock);
+  vector<double> sorted(latencies_ms);
+  sort(sorted.begin(), sorted.end());
+  double p50 = sorted.empty() ? 0 : sorted[(sorted.size() - 1) * 50 / 100],
+         p99 = sorted.empty() ? 0 : sorted[(sorted.size() - 1) * 99 / 100];
+  double uptime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  ostringstream out;
+  out << "p50_ms=" << p50 << " p99_ms=" << p99 << " queue_depth=" << depth
+      << " completed=" << completed << " batches=" << batches
+      << " throughput_per_s=" << (uptime > 0 ? completed / uptime : 0) << "\n";
+  return out.str();
+}
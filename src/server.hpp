@@ -0,0 +1,86 @@
+/**
+    * Long-running encrypted inference server.
+    * Loads the cloud key and an ApproxLogRegression model once, accepts encrypted feature vectors over a
+    * Unix-domain socket or localhost TCP, coalesces concurrent requests into batches for predict_batch,
+    * and streams every encrypted result back as soon as its batch completes.
+    *
+    * Protocol (wire.hpp): a client sends SERVER_PREDICT with count = dim, size = bits, then dim values, or
+    * SERVER_PREDICT | WIRE_SEEDED followed by seeded samples (expanded on arrival);
+    * the reply is SERVER_RESULT with one value. SERVER_STATS is answered with a text payload of count bytes.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "logistic.hpp"
+
+enum ServerOp {
+  SERVER_PREDICT = 16,
+  SERVER_RESULT,
+  SERVER_STATS,
+  SERVER_ERROR
+};
+
+struct ServerConfig {
+  std::string unix_path;  // listen on this Unix socket if not empty
+  int tcp_port;  // listen on 127.0.0.1:tcp_port if > 0
+  int max_batch;  // largest batch handed to predict_batch
+  int max_wait_ms;  // how long the first request of a batch waits for company
+};
+
+class InferenceServer {
+  private:
+    struct Connection {
+      int fd;
+      std::mutex write_lock;  // one reply at a time
+      int pending;  // queued or running requests, guarded by queue_lock
+    };
+
+    struct Request {
+      Connection* conn;
+      LweSample** X;
+      std::chrono::steady_clock::time_point arrival;
+    };
+
+    ApproxLogRegression* model;
+    const TFheGateBootstrappingCloudKeySet* ck;
+    ServerConfig config;
+
+    std::mutex queue_lock;
+    std::condition_variable queue_ready;
+    std::condition_variable drained;  // a request has been answered
+    std::deque<Request> queue;
+
+    /* metrics, guarded by stats_lock */
+    std::mutex stats_lock;
+    std::vector<double> latencies_ms;  // ring buffer of the last latencies
+    size_t latency_next;
+    uint64_t completed, batches;
+    std::chrono::steady_clock::time_point start;
+
+    void serveConnection(int fd);
+    void batchLoop();
+    void record(double latency_ms);
+
+  public:
+
+    InferenceServer(ApproxLogRegression* model, const TFheGateBootstrappingCloudKeySet* ck, ServerConfig config);
+
+    /**
+      Accepts clients until the listening sockets fail. Returns -1 if no socket could be opened
+    */
+    int run();
+
+    /**
+      p50/p99 latency over the recent window, queue depth, completed requests, batches and throughput
+    */
+    std::string stats();
+};
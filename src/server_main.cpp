@@ -0,0 +1,32 @@
+/*
+Encrypted inference daemon.
+Usage: SHE_server <cloud key> <weights csv> <coefs csv> <dim> <bits> <scale factor> <unix socket path | tcp port> [max batch] [max wait ms]
+*/
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "server.hpp"
+#include "worker.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  if(argc < 8) {
+    cout << "Usage: " << argv[0] << " <cloud key> <weights csv> <coefs csv> <dim> <bits> <scale factor> <unix socket path | tcp port> [max batch] [max wait ms]" << endl;
+    return 1;
+  }
+  const TFheGateBootstrappingCloudKeySet* ck = loadCloudKeyMapped(argv[1]);
+  if(ck == NULL) return 1;
+  ApproxLogRegression model(argv[2], argv[3], atoi(argv[4]), ck, atoi(argv[5]), atoi(argv[6]));
+
+  ServerConfig config;
+  string endpoint = argv[7];
+  config.tcp_port = endpoint.find_first_not_of("0123456789") == string::npos ? atoi(endpoint.c_str()) : 0;
+  config.unix_path = config.tcp_port > 0 ? "" : endpoint;
+  config.max_batch = argc > 8 ? atoi(argv[8]) : 16;
+  config.max_wait_ms = argc > 9 ? atoi(argv[9]) : 20;
+
+  InferenceServer server(&model, ck, config);
+  cout << "Serving on " << endpoint << endl;
+  return server.run() == 0 ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include "session.hpp"
+#include "alu.hpp"
+
+using namespace std;
+
+ScoringSession::Entry::Entry(size_t size, const TFheGateBootstrappingCloudKeySet* ck)
+  : pre(new_gate_bootstrapping_ciphertext_array(size, ck->params)), size(size) {}
+
+ScoringSession::Entry::~Entry() {
+  delete_gate_bootstrapping_ciphertext_array(size, pre);
+}
+
+ScoringSession::ScoringSession(ApproxLogRegression* model, const TFheGateBootstrappingCloudKeySet* ck)
+  : model(model), ck(ck) {}
+
+/**
+The activation reads its input while it writes y, so it runs on a copy of the cached preactivation
+*/
+static void activate(ApproxLogRegression* model, LweSample* y, const LweSample* pre, const TFheGateBootstrappingCloudKeySet* ck) {
+  const size_t size = model->getSize();
+  LweSample *temp = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  copy(temp, pre, ck, size);
+  model->approxSigmoid(y, temp);
+  delete_gate_bootstrapping_ciphertext_array(size, temp);
+}
+
+void ScoringSession::score(LweSample* y, const uint64_t id, LweSample** X) {
+  shared_ptr<Entry> entry = make_shared<Entry>(model->getSize(), ck);
+  lock_guard<mutex> entry_lock(entry->lock);
+  {
+    lock_guard<mutex> guard(lock);
+    cache[id] = entry;
+  }
+  model->preactivation(entry->pre, X);
+  activate(model, y, entry->pre, ck);
+}
+
+int ScoringSession::rescore(LweSample* y, const uint64_t id, const int* features, LweSample** deltas, const int count) {
+  for(int k = 0; k < count; k++) {
+    if(features[k] < 0 || features[k] >= model->getDim()) {
+      cout << "Error: feature " << features[k] << " out of range" << endl;
+      return -1;
+    }
+  }
+  shared_ptr<Entry> entry;
+  {
+    lock_guard<mutex> guard(lock);
+    unordered_map<uint64_t, shared_ptr<Entry>>::iterator it = cache.find(id);
+    if(it == cache.end()) {
+      cout << "Error: sample " << id << " is not cached" << endl;
+      return -1;
+    }
+    entry = it->second;
+  }
+  lock_guard<mutex> entry_lock(entry->lock);
+  model->updatePreactivation(entry->pre, features, deltas, count);
+  activate(model, y, entry->pre, ck);
+  return 0;
+}
+
+void ScoringSession::drop(const uint64_t id) {
+  lock_guard<mutex> guard(lock);
+  cache.erase(id);
+}
+
+size_t ScoringSession::cached() {
+  lock_guard<mutex> guard(lock);
+  return cache.size();
+}
@@ -0,0 +1,58 @@
+/**
+    * Incremental re-scoring. A ScoringSession keeps the encrypted preactivation of every sample it has scored, under
+    * an id chosen by the caller. When a client re-submits a sample with a few features changed, it sends encrypted
+    * deltas (new - old, at the fixed point of the inputs) for those features only: the cached preactivation is
+    * updated with their weighted sum (ApproxLogRegression::updatePreactivation) and only the activation is run again.
+    * The cost is proportional to the number of changed features instead of dim.
+    *
+    * Sessions are thread safe: the cache is guarded by one lock, and each sample by its own, so different samples are
+    * scored concurrently and updates of the same sample are applied one after the other.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "logistic.hpp"
+
+class ScoringSession {
+  private:
+    struct Entry {
+      std::mutex lock;
+      LweSample* pre;  // cached preactivation, size bits
+      size_t size;
+
+      Entry(size_t size, const TFheGateBootstrappingCloudKeySet* ck);
+      ~Entry();
+    };
+
+    ApproxLogRegression* model;
+    const TFheGateBootstrappingCloudKeySet* ck;
+    std::mutex lock;
+    std::unordered_map<uint64_t, std::shared_ptr<Entry>> cache;
+
+  public:
+
+    ScoringSession(ApproxLogRegression* model, const TFheGateBootstrappingCloudKeySet* ck);
+
+    /**
+      Full inference of sample X (getDim() values) into y. The preactivation is cached under id, replacing an earlier one
+    */
+    void score(LweSample* y, const uint64_t id, LweSample** X);
+
+    /**
+      Inference of the sample cached under id after adding deltas[k] to feature features[k], for count features.
+      The cache holds the updated preactivation afterwards. Returns -1 if id is not cached or a feature is out of range
+    */
+    int rescore(LweSample* y, const uint64_t id, const int* features, LweSample** deltas, const int count);
+
+    /** Forgets the sample cached under id */
+    void drop(const uint64_t id);
+
+    size_t cached();
+};
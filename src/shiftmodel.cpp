@@ -0,0 +1,112 @@
+#include <cmath>
+#include <iostream>
+#include "shiftmodel.hpp"
+#include "io.hpp"
+
+using namespace std;
+
+int writeShiftModel(const ShiftModel& model, string filepath) {
+  vector<vector<double>> lines;
+  lines.push_back({(double) model.frac_bits, (double) model.layers.size()});
+  for(const ShiftLayer& layer: model.layers) {
+    lines.push_back({(double) layer.rows, (double) layer.cols, (double) layer.terms, (double) layer.bits, (double) layer.relu});
+    for(int r = 0; r < layer.rows; r++) {
+      vector<double> row;
+      for(int q = r * layer.cols * layer.terms; q < (r + 1) * layer.cols * layer.terms; q++) {
+        row.push_back(layer.signs[q]);
+        row.push_back(layer.exps[q]);
+      }
+      row.push_back(layer.bias[r]);
+      lines.push_back(row);
+    }
+  }
+  return writeFile(lines, filepath);
+}
+
+int readShiftModel(ShiftModel& model, string filepath) {
+  vector<vector<double>> lines = readFile(filepath);
+  if(lines.empty() || lines[0].size() != 2) {
+    cout << "Error: " << filepath << " is not a shift model." << endl;
+    return -1;
+  }
+  if(lines[0][1] < 1 || lines[0][1] > lines.size()) {
+    cout << "Error: " << filepath << ": bad layer count." << endl;
+    return -1;
+  }
+  model.frac_bits = lines[0][0];
+  model.layers.assign(lines[0][1], ShiftLayer());
+  size_t next = 1;
+  for(size_t l = 0; l < model.layers.size(); l++) {
+    ShiftLayer& layer = model.layers[l];
+    if(next >= lines.size() || lines[next].size() != 5) {
+      cout << "Error: " << filepath << ": bad layer header on line " << next + 1 << "." << endl;
+      return -1;
+    }
+    layer.rows = lines[next][0];
+    layer.cols = lines[next][1];
+    layer.terms = lines[next][2];
+    layer.bits = lines[next][3];
+    layer.relu = lines[next][4] != 0;
+    // layer l reads the outputs of layer l - 1
+    if(layer.rows < 1 || layer.cols < 1 || layer.terms < 1 || layer.bits < 1 || layer.bits > 32
+       || (l > 0 && layer.cols != model.layers[l-1].rows)) {
+      cout << "Error: " << filepath << ": bad layer shape on line " << next + 1 << "." << endl;
+      return -1;
+    }
+    next++;
+    for(int r = 0; r < layer.rows; r++, next++) {
+      if(next >= lines.size() || (int) lines[next].size() != 2 * layer.cols * layer.terms + 1) {
+        cout << "Error: " << filepath << ": bad weight row on line " << next + 1 << "." << endl;
+        return -1;
+      }
+      for(int q = 0; q < layer.cols * layer.terms; q++) {
+        layer.signs.push_back(lines[next][2*q]);
+        layer.exps.push_back(lines[next][2*q + 1]);
+      }
+      layer.bias.push_back(lines[next].back());
+    }
+  }
+  return 0;
+}
+
+/*
+Exhaustive over the exponent range, which is at most a few dozen exponents: with two terms that is the best pair,
+not the greedy power-of-two-of-the-residual
+*/
+double quantizePow2(const double w, const int terms, const int min_exp, const int max_exp, int* signs, int* exps) {
+  double best = 0, best_err = fabs(w);
+  int s1 = 0, e1 = min_exp, s2 = 0, e2 = min_exp;
+  for(int a = min_exp; a <= max_exp; a++) {
+    for(int sa = -1; sa <= 1; sa += 2) {
+      const double va = sa * ldexp(1.0, a);
+      if(fabs(w - va) < best_err) {
+        best = va; best_err = fabs(w - va);
+        s1 = sa; e1 = a; s2 = 0; e2 = min_exp;
+      }
+      if(terms < 2) continue;
+      for(int b = min_exp; b < a; b++) {
+        for(int sb = -1; sb <= 1; sb += 2) {
+          const double v = va + sb * ldexp(1.0, b);
+          if(fabs(w - v) < best_err) {
+            best = v; best_err = fabs(w - v);
+            s1 = sa; e1 = a; s2 = sb; e2 = b;
+          }
+        }
+      }
+    }
+  }
+  signs[0] = s1; exps[0] = e1;
+  if(terms > 1) {
+    signs[1] = s2; exps[1] = e2;
+  }
+  return best;
+}
+
+void foldBatchNorm(vector<vector<double>>& weights, vector<double>& bias, const vector<double>& gamma,
+                   const vector<double>& beta, const vector<double>& mean, const vector<double>& var, const double eps) {
+  for(size_t r = 0; r < weights.size(); r++) {
+    const double scale = gamma[r] / sqrt(var[r] + eps);
+    for(double& w: weights[r]) w *= scale;
+    bias[r] = scale * (bias[r] - mean[r]) + beta[r];
+  }
+}
@@ -0,0 +1,50 @@
+/**
+    * Power-of-two quantized models for the shift-only encrypted path.
+    * Every weight is a sum of up to `terms` signed powers of two, sign * 2^exp, so multiplying an encrypted value by it
+    * is a relabelling of bits (exp > 0: left shift, exp < 0: arithmetic right shift) and an add or a sub: no AND gate.
+    * Activations are fixed point with frac_bits fraction bits; layer l computes at bits[l] bits.
+    *
+    * Model file, CSV lines read and written with io.cpp:
+    *   frac_bits, layers
+    * then per layer
+    *   rows, cols, terms, bits, relu
+    *   and rows lines of cols * terms (sign, exp) pairs followed by the bias (fixed point)
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ShiftLayer {
+  int rows;  // outputs
+  int cols;  // inputs
+  int terms;  // powers of two per weight
+  int bits;  // width of the inputs, the sums and the outputs
+  bool relu;  // ReLU on the outputs
+  std::vector<int> signs;  // rows * cols * terms, -1, 0 (unused term) or 1
+  std::vector<int> exps;  // rows * cols * terms
+  std::vector<int> bias;  // rows, at 2^frac_bits
+};
+
+struct ShiftModel {
+  int frac_bits;
+  std::vector<ShiftLayer> layers;
+};
+
+int writeShiftModel(const ShiftModel& model, std::string filepath);
+// Checks the shapes: layer l has as many inputs as layer l - 1 has outputs. Returns -1 on error
+int readShiftModel(ShiftModel& model, std::string filepath);
+
+/*
+  Nearest sum of up to terms (1 or 2) signed powers of two to w, exponents in [min_exp, max_exp]. Writes the terms to
+  signs / exps and returns the value they represent
+*/
+double quantizePow2(const double w, const int terms, const int min_exp, const int max_exp, int* signs, int* exps);
+
+/*
+  Folds batch norm gamma * (z - mean) / sqrt(var + eps) + beta into the rows x cols weights and the rows biases of
+  z = W x + b
+*/
+void foldBatchNorm(std::vector<std::vector<double>>& weights, std::vector<double>& bias, const std::vector<double>& gamma,
+                   const std::vector<double>& beta, const std::vector<double>& mean, const std::vector<double>& var, const double eps=1e-5);
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include "simulator.hpp"
+#include "numeric.hpp"
+#include "reference.hpp"
+
+int64_t sim_wrap(int64_t value, const int bits, bool& overflow) {
+  const uint64_t mask = bits >= 64 ? ~UINT64_C(0) : (UINT64_C(1) << bits) - 1;
+  uint64_t low = (uint64_t) value & mask;
+  // sign extend from bit bits-1
+  int64_t wrapped = (bits < 64 && (low >> (bits - 1)) & 1) ? (int64_t) (low | ~mask) : (int64_t) low;
+  if(wrapped != value) overflow = true;
+  return wrapped;
+}
+
+int64_t sim_add(int64_t a, int64_t b, const int bits, bool& overflow) {
+  return sim_wrap(a + b, bits, overflow);
+}
+
+int64_t sim_sub(int64_t a, int64_t b, const int bits, bool& overflow) {
+  return sim_wrap(a - b, bits, overflow);
+}
+
+/* mult only generates the partial products of the low `bits` bits, i.e. the product modulo 2^bits */
+int64_t sim_mult(int64_t a, int64_t b, const int bits, bool& overflow) {
+  return sim_wrap(a * b, bits, overflow);
+}
+
+/* mult_fixed: the windowed product of ref_mult_fixed, overflowing when the rounded product does not fit in bits */
+int64_t sim_mult_fixed(int64_t a, int64_t b, const int frac_bits, const int bits, bool& overflow) {
+  const int64_t half = frac_bits > 0 ? INT64_C(1) << (frac_bits - 1) : 0;
+  bool exact_overflow = false;
+  sim_wrap((a * b + half) >> frac_bits, bits, exact_overflow);
+  if(exact_overflow) overflow = true;
+  return ref_mult_fixed((int32_t) a, (int32_t) b, frac_bits, bits);
+}
+
+int64_t sim_leftShift(int64_t a, const int amnt, const int bits, bool& overflow) {
+  return sim_wrap((int64_t) ((uint64_t) a << amnt), bits, overflow);
+}
+
+/* rightShift fills the top bits with zeros: a logical shift of the bits-wide pattern, negative values become positive */
+int64_t sim_rightShift(int64_t a, const int amnt, const int bits, bool& overflow) {
+  const uint64_t mask = (UINT64_C(1) << bits) - 1;
+  bool ignore = false;
+  int64_t result = sim_wrap((int64_t) ((((uint64_t) a) & mask) >> amnt), bits, ignore);
+  if(result != (a >> amnt)) overflow = true;
+  return result;
+}
+
+/* shiftDot: elem_shift then seq_add, same order as matrix.cpp */
+int64_t sim_shiftDot(const int64_t* a, const int* b, const int cols, const int bits, bool& overflow) {
+  int64_t result = 0;
+  for(int j = 0; j < cols; j++) {
+    int64_t term = b[j] < 0 ? sim_rightShift(a[j], -b[j], bits, overflow)
+                            : sim_leftShift(a[j], b[j], bits, overflow);
+    result = sim_add(result, term, bits, overflow);
+  }
+  return result;
+}
+
+/* float_to_fixed, flagging values that get clipped as overflows too */
+template<typename T>
+static int64_t quantize(double flt, const int bits, const int factor, const bool clip, bool& overflow) {
+  T fixed = float_to_fixed<T>(flt, bits, factor, clip);
+  if((int64_t) fixed != (int64_t) (flt * factor)) overflow = true;
+  return fixed;
+}
+
+FixedPointSimulator::FixedPointSimulator(std::vector<double> weights, std::vector<double> coefs, size_t scale_factor, int input_factor, bool mode_clip)
+  : weights(weights), coefs(coefs), scale_factor(scale_factor), frac_bits(0), input_factor(input_factor), mode_clip(mode_clip) {
+  while((size_t) 2 << frac_bits <= scale_factor) frac_bits++;
+  if(this->input_factor == 0) this->input_factor = 1 << frac_bits;
+}
+
+/*
+Mirrors ApproxLogRegression: weights are float_to_fixed<int>(w, bits, 1), coefficients float_to_fixed<int>(c, bits,
+2^frac_bits), and Horner's algorithm rescales every product with mult_fixed
+*/
+int64_t FixedPointSimulator::predict(const std::vector<double>& x, const int dot_bits, const int act_bits, bool& overflow, bool& decision) const {
+  const int dim = weights.size();
+  bool ignore = false;
+
+  // preactivation: dot(weights, X) = reduce_add of the products
+  int64_t pre = 0;
+  for(int i = 0; i < dim; i++) {
+    int64_t w = sim_wrap(quantize<int>(weights[i], dot_bits, 1, mode_clip, overflow), dot_bits, ignore);
+    int64_t xi = sim_wrap(quantize<int>(x[i], dot_bits, input_factor, mode_clip, overflow), dot_bits, ignore);
+    pre = sim_add(pre, sim_mult(w, xi, dot_bits, overflow), dot_bits, overflow);
+  }
+  // the activation layer reads the preactivation at its own width
+  pre = sim_wrap(pre, act_bits, overflow);
+
+  // Horner's algorithm, as approxSigmoid
+  const int degree = coefs.size() - 1;
+  std::vector<int64_t> c(degree + 1);
+  for(int i = 0; i <= degree; i++) {
+    c[i] = sim_wrap(quantize<int>(coefs[i], act_bits, 1 << frac_bits, mode_clip, overflow), act_bits, ignore);
+  }
+  int64_t y = c[degree];
+  for(int i = degree - 1; i >= 0; i--) {
+    y = sim_add(c[i], sim_mult_fixed(y, pre, frac_bits, act_bits, overflow), act_bits, overflow);
+  }
+  decision = frac_bits > 0 ? y >= INT64_C(1) << (frac_bits - 1) : y >= 1;
+  return y;
+}
+
+WidthReport FixedPointSimulator::evaluate(const std::vector<std::vector<double>>& X, const std::vector<double>& labels, const int bits) const {
+  WidthReport report = {bits, 0, 0, labels.empty() ? -1.0 : 0.0};
+  if(X.empty()) return report;
+  int overflows = 0, agree = 0, correct = 0;
+  for(size_t s = 0; s < X.size(); s++) {
+    bool overflow = false, decision, ref_overflow = false, ref_decision;
+    predict(X[s], bits, bits, overflow, decision);
+    predict(X[s], 32, 32, ref_overflow, ref_decision);
+    overflows += overflow;
+    agree += decision == ref_decision;
+    if(!labels.empty()) correct += decision == (labels[s] != 0);
+  }
+  report.overflow_rate = (double) overflows / X.size();
+  report.agreement = (double) agree / X.size();
+  if(!labels.empty()) report.accuracy = (double) correct / X.size();
+  return report;
+}
+
+WidthReport FixedPointSimulator::selectWidth(const std::vector<std::vector<double>>& X, const std::vector<double>& labels, const double target,
+                                             std::vector<WidthReport>& reports, const int min_bits, const int max_bits) const {
+  for(int bits = min_bits; bits <= max_bits; bits++) {
+    WidthReport r = evaluate(X, labels, bits);
+    reports.push_back(r);
+    if((labels.empty() ? r.agreement : r.accuracy) >= target) return r;
+  }
+  return reports.back();
+}
@@ -0,0 +1,64 @@
+/**
+    * Plaintext fixed-point simulator of the encrypted pipelines.
+    * Runs the exact integer semantics of the ALU circuits at a given bit width - two's complement wraparound of
+    * add, mult keeping the low bits of the product, mult_fixed rescaling rounded products, zero-filling shifts,
+    * and the clipping coefficient conversion done by ApproxLogRegression - and counts overflows. Used to pick the narrowest width
+    * that keeps a target accuracy, since every bootstrap of the encrypted run scales with the width. ApproxLogRegression
+    * runs all its layers at one width (its size), so the search is over one width shared by the layers.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Bit-exact models of the ALU operations. overflow is set when the result differs from exact integer arithmetic */
+int64_t sim_wrap(int64_t value, const int bits, bool& overflow);
+int64_t sim_add(int64_t a, int64_t b, const int bits, bool& overflow);
+int64_t sim_sub(int64_t a, int64_t b, const int bits, bool& overflow);
+int64_t sim_mult(int64_t a, int64_t b, const int bits, bool& overflow);
+int64_t sim_mult_fixed(int64_t a, int64_t b, const int frac_bits, const int bits, bool& overflow);
+int64_t sim_leftShift(int64_t a, const int amnt, const int bits, bool& overflow);
+int64_t sim_rightShift(int64_t a, const int amnt, const int bits, bool& overflow);
+int64_t sim_shiftDot(const int64_t* a, const int* b, const int cols, const int bits, bool& overflow);
+
+struct WidthReport {
+  int bits;  // width of both the preactivation and the polynomial activation layer
+  double overflow_rate;  // fraction of samples with at least one overflow or clipped quantization
+  double agreement;  // fraction of decisions equal to the 32-bit run
+  double accuracy;  // fraction of decisions equal to the labels, -1 without labels
+};
+
+class FixedPointSimulator {
+  private:
+    std::vector<double> weights;
+    std::vector<double> coefs;
+    size_t scale_factor;
+    int frac_bits;  // log2(scale_factor), rounded down as ApproxLogRegression does
+    int input_factor;  // features are quantized as float_to_fixed(x, dot_bits, input_factor)
+    bool mode_clip;
+
+  public:
+
+    FixedPointSimulator(std::vector<double> weights, std::vector<double> coefs, size_t scale_factor, int input_factor=0, bool mode_clip=true);
+
+    /**
+      Output of ApproxLogRegression::predict for one sample, with the preactivation at dot_bits and Horner's
+      algorithm at act_bits. decision is output >= 1/2 at frac_bits fraction bits, i.e. sigmoid >= 1/2.
+      input_factor 0 quantizes the features at 2^frac_bits, which puts the preactivation on the coefficients' scale
+    */
+    int64_t predict(const std::vector<double>& x, const int dot_bits, const int act_bits, bool& overflow, bool& decision) const;
+
+    /**
+      Runs every sample of X with both layers at bits. labels may be empty
+    */
+    WidthReport evaluate(const std::vector<std::vector<double>>& X, const std::vector<double>& labels, const int bits) const;
+
+    /**
+      Smallest width, shared by the layers, meeting target on accuracy (or on agreement without labels); max_bits if
+      none does. Reports of all candidates are appended to reports
+    */
+    WidthReport selectWidth(const std::vector<std::vector<double>>& X, const std::vector<double>& labels, const double target,
+                            std::vector<WidthReport>& reports, const int min_bits=2, const int max_bits=32) const;
+};
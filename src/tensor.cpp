@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <iostream>
+#include "tensor.hpp"
+#include "omp_constants.hpp"
+
+using namespace std;
+
+/**
+The sample headers are written in place rather than constructed: TFHE's LweSample constructor allocates its own
+mask, which is exactly the per-sample allocation this class avoids. The samples must not be passed to
+delete_gate_bootstrapping_ciphertext_array, the tensor owns them
+*/
+CipherTensor::CipherTensor(const int rows, const int cols, const size_t bits, const TFheGateBootstrappingParameterSet* params, const TensorLayout layout)
+  : rows(rows), cols(cols), bits(bits), layout(layout), params(params->in_out_params) {
+  const int per_line = TENSOR_ALIGNMENT / sizeof(Torus32);
+  stride = (this->params->n + per_line - 1) / per_line * per_line;
+  const size_t n = (size_t) rows * cols * bits;
+  void *mask_block = NULL, *sample_block = NULL;
+  if(posix_memalign(&mask_block, TENSOR_ALIGNMENT, (n ? n : 1) * stride * sizeof(Torus32)) != 0 ||
+     posix_memalign(&sample_block, TENSOR_ALIGNMENT, (n ? n : 1) * sizeof(LweSample)) != 0) {
+    cout << "Error: cannot allocate a tensor of " << n << " samples" << endl;
+    free(mask_block);
+    masks = NULL;
+    samples = NULL;
+    this->rows = this->cols = 0;
+    return;
+  }
+  masks = (Torus32*) mask_block;
+  samples = (LweSample*) sample_block;
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(size_t s = 0; s < n; s++) {
+    samples[s].a = &masks[s * stride];
+    lweClear(&samples[s], this->params);
+  }
+}
+
+CipherTensor::~CipherTensor() {
+  free(samples);
+  free(masks);
+}
+
+LweSample* CipherTensor::element(const int e) {
+  if(layout != ELEMENT_MAJOR) {
+    cout << "Error: element() of a bit-plane tensor" << endl;
+    return NULL;
+  }
+  return &samples[e * bits];
+}
+
+const LweSample* CipherTensor::element(const int e) const {
+  return const_cast<CipherTensor*>(this)->element(e);
+}
+
+LweSample* CipherTensor::plane(const size_t k) {
+  if(layout != BIT_PLANE_MAJOR) {
+    cout << "Error: plane() of an element-major tensor" << endl;
+    return NULL;
+  }
+  return &samples[k * count()];
+}
+
+const LweSample* CipherTensor::plane(const size_t k) const {
+  return const_cast<CipherTensor*>(this)->plane(k);
+}
+
+void CipherTensor::copyFrom(const CipherTensor& src) {
+  if(src.rows != rows || src.cols != cols || src.bits != bits) {
+    cout << "Error: copy of a " << src.rows << "x" << src.cols << "x" << src.bits << " tensor into a "
+         << rows << "x" << cols << "x" << bits << " tensor" << endl;
+    return;
+  }
+  const int n = count();
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(int e = 0; e < n; e++) {
+    for(size_t k = 0; k < bits; k++) {
+      lweCopy(&samples[index(e, k)], &src.samples[src.index(e, k)], params);
+    }
+  }
+}
+
+void CipherTensor::load(LweSample*** src) {
+  #pragma omp parallel for num_threads(NUM_THREADS) collapse(2)
+  for(int i = 0; i < rows; i++) {
+    for(int j = 0; j < cols; j++) {
+      for(size_t k = 0; k < bits; k++) {
+        lweCopy(bit(i, j, k), &src[i][j][k], params);
+      }
+    }
+  }
+}
+
+void CipherTensor::store(LweSample*** dst) const {
+  #pragma omp parallel for num_threads(NUM_THREADS) collapse(2)
+  for(int i = 0; i < rows; i++) {
+    for(int j = 0; j < cols; j++) {
+      for(size_t k = 0; k < bits; k++) {
+        lweCopy(&dst[i][j][k], bit(i, j, k), params);
+      }
+    }
+  }
+}
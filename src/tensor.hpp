@@ -0,0 +1,79 @@
+/**
+    * Contiguous storage for tensors of encrypted integers.
+    * A CipherTensor holds rows x cols elements of `bits` bits. All LweSample headers are one array and all their
+    * mask vectors one 64-byte aligned block, instead of a heap-allocated bit array per element behind LweSample***.
+    * Two layouts:
+      - ELEMENT_MAJOR: the bits of an element are contiguous, so element(i, j) is an operand of the alu.hpp functions
+      - BIT_PLANE_MAJOR: bit k of every element is contiguous, so plane(k) is one batch of count gates. Ops that
+        touch the same bit of many elements (the ReLU sign bit, a level of a ripple carry) stream memory in order
+    copyFrom converts between layouts, it copies samples and needs no bootstrap.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+
+#define TENSOR_ALIGNMENT 64
+
+enum TensorLayout {
+  ELEMENT_MAJOR,
+  BIT_PLANE_MAJOR
+};
+
+class CipherTensor {
+  private:
+    LweSample *samples;  // rows * cols * bits sample headers, in layout order
+    Torus32 *masks;  // the mask vectors of all samples, stride ints apart
+    int rows;
+    int cols;
+    size_t bits;
+    int stride;  // LWE dimension rounded up to TENSOR_ALIGNMENT bytes
+    TensorLayout layout;
+    const LweParams *params;
+
+  public:
+
+    CipherTensor(const int rows, const int cols, const size_t bits, const TFheGateBootstrappingParameterSet* params, const TensorLayout layout=ELEMENT_MAJOR);
+    ~CipherTensor();
+
+    CipherTensor(const CipherTensor&) = delete;
+    CipherTensor& operator=(const CipherTensor&) = delete;
+
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+    int count() const { return rows * cols; }
+    size_t getBits() const { return bits; }
+    TensorLayout getLayout() const { return layout; }
+    const LweParams* getParams() const { return params; }
+
+    /* Position of bit k of element e (row-major element index) in the sample array */
+    size_t index(const int e, const size_t k) const {
+      return layout == ELEMENT_MAJOR ? e * bits + k : k * count() + e;
+    }
+
+    LweSample* bit(const int i, const int j, const size_t k) { return &samples[index(i * cols + j, k)]; }
+    const LweSample* bit(const int i, const int j, const size_t k) const { return &samples[index(i * cols + j, k)]; }
+
+    /* The bits-wide array of element e, ELEMENT_MAJOR only */
+    LweSample* element(const int e);
+    const LweSample* element(const int e) const;
+    LweSample* element(const int i, const int j) { return element(i * cols + j); }
+    const LweSample* element(const int i, const int j) const { return element(i * cols + j); }
+
+    /* The count() samples of bit k, BIT_PLANE_MAJOR only */
+    LweSample* plane(const size_t k);
+    const LweSample* plane(const size_t k) const;
+
+    /* All rows * cols * bits samples */
+    LweSample* data() { return samples; }
+    const LweSample* data() const { return samples; }
+
+    /* Copies src, of the same shape and width, whatever the layouts */
+    void copyFrom(const CipherTensor& src);
+
+    /* Conversions from and to the pointer-forest matrices of matrix.hpp, element [i][j] of bits bits */
+    void load(LweSample*** src);
+    void store(LweSample*** dst) const;
+};
@@ -0,0 +1,36 @@
+/*
+Picks the bit width (the size, shared by all layers) of ApproxLogRegression with the plaintext simulator.
+Usage: SHE_widths <weights csv> <coefs csv> <data csv, label in last column> <scale factor> <target accuracy> [input factor, default scale factor]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "io.hpp"
+#include "simulator.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  if(argc < 6) {
+    cout << "Usage: " << argv[0] << " <weights csv> <coefs csv> <data csv, label in last column> <scale factor> <target accuracy> [input factor, default scale factor]" << endl;
+    return 1;
+  }
+  vector<vector<double>> weights = readFile(argv[1]), coefs = readFile(argv[2]), data = readFile(argv[3]);
+  if(weights.empty() || coefs.empty() || data.empty()) return 1;
+  vector<double> labels;
+  for(vector<double>& row: data) {
+    labels.push_back(row.back());
+    row.pop_back();
+  }
+  FixedPointSimulator sim(weights[0], coefs[0], atoi(argv[4]), argc > 6 ? atoi(argv[6]) : 0);
+
+  vector<WidthReport> reports;
+  WidthReport best = sim.selectWidth(data, labels, atof(argv[5]), reports);
+  printf("bits overflow_rate agreement accuracy\n");
+  for(const WidthReport& r: reports) {
+    printf("%4d %13.4f %9.4f %8.4f\n", r.bits, r.overflow_rate, r.agreement, r.accuracy);
+  }
+  printf("Selected: bits=%d (overflow_rate=%.4f, accuracy=%.4f)\n", best.bits, best.overflow_rate, best.accuracy);
+  return 0;
+}
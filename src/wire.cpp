@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "wire.hpp"
+#include "omp_constants.hpp"
+
+int writeAll(int fd, const void* buf, size_t len) {
+  const char *p = (const char*) buf;
+  struct stat st;
+  // MSG_NOSIGNAL: a dead peer should give an error, not SIGPIPE
+  const bool is_socket = fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+  while(len > 0) {
+    ssize_t n = is_socket ? send(fd, p, len, MSG_NOSIGNAL) : write(fd, p, len);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) return -1;
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int readAll(int fd, void* buf, size_t len) {
+  char *p = (char*) buf;
+  while(len > 0) {
+    ssize_t n = read(fd, p, len);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) return -1;
+    p += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int writeHeader(int fd, uint32_t op, uint32_t count, uint32_t size, uint32_t params) {
+  WireHeader header = {WIRE_MAGIC, op, count, size, params};
+  return writeAll(fd, &header, sizeof(header));
+}
+
+int readHeader(int fd, WireHeader& header) {
+  // the stream may only end between messages
+  char *p = (char*) &header;
+  ssize_t n;
+  do {
+    n = read(fd, p, sizeof(header));
+  } while(n < 0 && errno == EINTR);
+  if(n == 0) return 1;
+  if(n < 0 || readAll(fd, p + n, sizeof(header) - n) < 0) return -1;
+  return header.magic == WIRE_MAGIC ? 0 : -1;
+}
+
+/*
+Samples are packed into one buffer so a message costs one system call, not one per sample
+*/
+int writeSamples(int fd, const LweSample* x, const int count, const LweParams* params) {
+  const int32_t n = params->n;
+  std::vector<int32_t> buf((size_t) count * (n + 1));
+  for(int k = 0; k < count; k++) {
+    int32_t *dst = &buf[(size_t) k * (n + 1)];
+    dst[0] = x[k].b;
+    for(int32_t i = 0; i < n; i++) dst[i + 1] = x[k].a[i];
+  }
+  return writeAll(fd, buf.data(), buf.size() * sizeof(int32_t));
+}
+
+int readSamples(int fd, LweSample* x, const int count, const LweParams* params) {
+  const int32_t n = params->n;
+  std::vector<int32_t> buf((size_t) count * (n + 1));
+  if(readAll(fd, buf.data(), buf.size() * sizeof(int32_t)) < 0) return -1;
+  for(int k = 0; k < count; k++) {
+    const int32_t *src = &buf[(size_t) k * (n + 1)];
+    x[k].b = src[0];
+    for(int32_t i = 0; i < n; i++) x[k].a[i] = src[i + 1];
+    x[k].current_variance = 0;
+  }
+  return 0;
+}
+
+/*
+ChaCha20 block function (RFC 8439) with a 64-bit nonce in nonce words 1-2, as a stream of mask values
+*/
+#define CHACHA_ROTL(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+#define CHACHA_QR(a, b, c, d) \
+  a += b; d ^= a; d = CHACHA_ROTL(d, 16); \
+  c += d; b ^= c; b = CHACHA_ROTL(b, 12); \
+  a += b; d ^= a; d = CHACHA_ROTL(d, 8); \
+  c += d; b ^= c; b = CHACHA_ROTL(b, 7);
+
+static void chachaBlock(uint32_t* out, const uint32_t* key, const uint32_t counter, const uint64_t nonce) {
+  uint32_t x[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+                    key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+                    counter, 0, (uint32_t) nonce, (uint32_t) (nonce >> 32)};
+  uint32_t in[16];
+  memcpy(in, x, sizeof(x));
+  for(int round = 0; round < 10; round++) {
+    CHACHA_QR(x[0], x[4], x[8], x[12]) CHACHA_QR(x[1], x[5], x[9], x[13])
+    CHACHA_QR(x[2], x[6], x[10], x[14]) CHACHA_QR(x[3], x[7], x[11], x[15])
+    CHACHA_QR(x[0], x[5], x[10], x[15]) CHACHA_QR(x[1], x[6], x[11], x[12])
+    CHACHA_QR(x[2], x[7], x[8], x[13]) CHACHA_QR(x[3], x[4], x[9], x[14])
+  }
+  for(int i = 0; i < 16; i++) out[i] = x[i] + in[i];
+}
+
+void seededMask(Torus32* a, const uint8_t* seed, const uint64_t index, const int n) {
+  uint32_t key[8], block[16];
+  for(int i = 0; i < 8; i++) {
+    key[i] = seed[4*i] | (uint32_t) seed[4*i + 1] << 8 | (uint32_t) seed[4*i + 2] << 16 | (uint32_t) seed[4*i + 3] << 24;
+  }
+  for(int i = 0; i < n; i += 16) {
+    chachaBlock(block, key, i / 16, index);
+    for(int j = 0; j < 16 && i + j < n; j++) a[i + j] = (Torus32) block[j];
+  }
+}
+
+void expandSeeded(LweSample* x, const SeededSamples& samples, const size_t first, const int count, const LweParams* params) {
+  #pragma omp parallel for num_threads(NUM_THREADS)
+  for(int k = 0; k < count; k++) {
+    seededMask(x[k].a, samples.seed, first + k, params->n);
+    x[k].b = samples.b[first + k];
+    x[k].current_variance = params->alpha_min * params->alpha_min;
+  }
+}
+
+int writeSeededSamples(int fd, const SeededSamples& samples) {
+  if(writeAll(fd, samples.seed, WIRE_SEED_BYTES) < 0) return -1;
+  return writeAll(fd, samples.b.data(), samples.b.size() * sizeof(int32_t));
+}
+
+int readSeededSamples(int fd, SeededSamples& samples, const size_t count) {
+  samples.b.clear();
+  if(count > WIRE_MAX_SEEDED) return -1;
+  if(readAll(fd, samples.seed, WIRE_SEED_BYTES) < 0) return -1;
+  for(size_t first = 0; first < count; first += WIRE_READ_CHUNK) {
+    const size_t n = std::min((size_t) WIRE_READ_CHUNK, count - first);
+    samples.b.resize(first + n);
+    if(readAll(fd, &samples.b[first], n * sizeof(int32_t)) < 0) return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+/**
+    * Binary wire format for ciphertexts, used between processes and for files.
+    * A message is a WireHeader followed by its payload. An LWE sample is written as b then a[0..n-1],
+    * as int32 in host byte order; the noise variance estimate is not transmitted.
+    * All functions work on file descriptors (sockets or files) and return 0 on success, -1 on error.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define WIRE_MAGIC 0x53484532  // "SHE2"
+#define WIRE_SEEDED 0x100  // op flag: the payload is seeded samples (writeSeededSamples) instead of full ones
+#define WIRE_SEED_BYTES 32
+#define WIRE_MAX_SEEDED (1 << 24)  // samples in one seeded message, 64 MiB of b
+#define WIRE_READ_CHUNK (1 << 16)  // samples read (and allocated) at a time by readSeededSamples
+
+struct WireHeader {
+  uint32_t magic;
+  uint32_t op;  // message type, defined by the protocol using the wire format
+  uint32_t count;  // number of operands / values
+  uint32_t size;  // bits per value
+  uint32_t params;  // paramsId (params.hpp) of the key the samples are encrypted under, 0 if there are no samples
+};
+
+int writeAll(int fd, const void* buf, size_t len);
+int readAll(int fd, void* buf, size_t len);
+
+int writeHeader(int fd, uint32_t op, uint32_t count, uint32_t size, uint32_t params=0);
+// Returns 0 for a header, 1 at the end of the stream before its first byte, -1 for a truncated or corrupt header
+int readHeader(int fd, WireHeader& header);
+
+int writeSamples(int fd, const LweSample* x, const int count, const LweParams* params);
+int readSamples(int fd, LweSample* x, const int count, const LweParams* params);
+
+/*
+  Seeded samples: the mask a of sample k is ChaCha20 keyed by seed with nonce k, so a message only carries the seed
+  and the b of every sample, 4 bytes per sample instead of 4 (n+1). Encrypt with encrypt_seeded (encryption.hpp) and
+  expand to LweSamples with expandSeeded just before the samples are used
+*/
+struct SeededSamples {
+  uint8_t seed[WIRE_SEED_BYTES];
+  std::vector<int32_t> b;
+};
+
+// The n mask values of sample index
+void seededMask(Torus32* a, const uint8_t* seed, const uint64_t index, const int n);
+// Samples first..first+count-1
+void expandSeeded(LweSample* x, const SeededSamples& samples, const size_t first, const int count, const LweParams* params);
+int writeSeededSamples(int fd, const SeededSamples& samples);
+// Rejects count above WIRE_MAX_SEEDED. The buffer grows as the samples arrive, so a truncated message does not
+// allocate its announced size
+int readSeededSamples(int fd, SeededSamples& samples, const size_t count);
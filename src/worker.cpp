@@ -0,0 +1,412 @@
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "worker.hpp"
+#include "wire.hpp"
+#include "alu.hpp"
+#include "bootstrap.hpp"
+#include "matrix.hpp"
+#include "params.hpp"
+
+using namespace std;
+
+/*
+TFHE rebuilds the FFT bootstrapping key in process memory when it imports a key, so the file mapping only
+saves the stdio copy of the file: the pages are shared through the page cache with every other worker
+reading the same file.
+*/
+TFheGateBootstrappingCloudKeySet* loadCloudKeyMapped(string key_path) {
+  int fd = open(key_path.c_str(), O_RDONLY);
+  if(fd < 0) {
+    cout << "Error: failed to open file." << endl;
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd, &st) < 0) {
+    cout << "Error: failed to stat key file." << endl;
+    close(fd);
+    return NULL;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) {
+    cout << "Error: failed to map key file." << endl;
+    return NULL;
+  }
+  FILE *stream = fmemopen(map, st.st_size, "r");
+  TFheGateBootstrappingCloudKeySet *ck = new_tfheGateBootstrappingCloudKeySet_fromFile(stream);
+  fclose(stream);
+  munmap(map, st.st_size);
+  return ck;
+}
+
+static int sendValue(int fd, uint32_t op, const LweSample* x, const size_t size, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(writeHeader(fd, op, 1, size, paramsId(ck->params)) < 0) return -1;
+  return writeSamples(fd, x, size, ck->params->in_out_params);
+}
+
+static int sendJob(int fd, const WorkerJob& job, const size_t size, const TFheGateBootstrappingCloudKeySet* ck) {
+  if(writeHeader(fd, job.op, job.operands.size(), size, paramsId(ck->params)) < 0) return -1;
+  if(job.op == WORKER_SHIFTDOT) {
+    vector<int32_t> shifts(job.shifts.begin(), job.shifts.end());
+    if(writeAll(fd, shifts.data(), shifts.size() * sizeof(int32_t)) < 0) return -1;
+  }
+  for(LweSample *x: job.operands) {
+    if(writeSamples(fd, x, size, ck->params->in_out_params) < 0) return -1;
+  }
+  return 0;
+}
+
+/* Number of operands an op needs, at least */
+static int minOperands(const uint32_t op) {
+  switch(op) {
+    case WORKER_ADD: case WORKER_SUB: case WORKER_MULT: return 2;
+    case WORKER_REDUCE_ADD: case WORKER_SHIFTDOT: return 1;
+    case WORKER_DOT: return 2;
+    default: return -1;
+  }
+}
+
+/*
+Reads the operands of one request and evaluates it into result. Returns 1 for a job that was read but cannot be
+evaluated (unknown op, too few operands): the connection is still in step and the job gets a WORKER_ERROR reply
+*/
+static int serveJob(int fd, const WireHeader& header, LweSample* result, const TFheGateBootstrappingCloudKeySet* ck) {
+  const int count = header.count;
+  const size_t size = header.size;
+  vector<int32_t> shifts;
+  if(header.op == WORKER_SHIFTDOT) {
+    shifts.resize(count);
+    if(readAll(fd, shifts.data(), count * sizeof(int32_t)) < 0) return -1;
+  }
+  LweSample **operands = new LweSample*[count];
+  int status = 0;
+  for(int i = 0; i < count; i++) {
+    operands[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    if(status == 0) status = readSamples(fd, operands[i], size, ck->params->in_out_params);
+  }
+  const int needed = minOperands(header.op);
+  if(status == 0 && (needed < 0 || count < needed || (header.op == WORKER_DOT && count % 2))) {
+    cout << "Error: worker rejected job " << header.op << " with " << count << " operands" << endl;
+    status = 1;
+  }
+  if(status == 0) {
+    switch(header.op) {
+      case WORKER_ADD: add(result, operands[0], operands[1], ck, size); break;
+      case WORKER_SUB: sub(result, operands[0], operands[1], ck, size); break;
+      case WORKER_MULT: mult(result, operands[0], operands[1], ck, size); break;
+      case WORKER_REDUCE_ADD: ::reduce_add(result, operands, count, ck, size); break;
+      case WORKER_DOT: {
+        const int n = count / 2;
+        LweSample **prod = new LweSample*[n];
+        for(int i = 0; i < n; i++) prod[i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+        mult_batch(prod, operands, operands + n, n, ck, size);
+        ::reduce_add(result, prod, n, ck, size);
+        for(int i = 0; i < n; i++) delete_gate_bootstrapping_ciphertext_array(size, prod[i]);
+        delete[] prod;
+        break;
+      }
+      case WORKER_SHIFTDOT: {
+        // circuit::shiftDot: no temporaries left behind in a long-lived worker, nothing printed
+        TfheBackend be(ck);
+        circuit::shiftDot(be, result, operands, shifts.data(), count, size);
+        break;
+      }
+    }
+  }
+  for(int i = 0; i < count; i++) {
+    delete_gate_bootstrapping_ciphertext_array(size, operands[i]);
+  }
+  delete[] operands;
+  return status;
+}
+
+static int connectTo(string socket_path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  socket_path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+  if(fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+    if(fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int runWorker(string socket_path, const TFheGateBootstrappingCloudKeySet* ck) {
+  int fd = connectTo(socket_path);
+  if(fd < 0) {
+    cout << "Error: worker failed to connect to " << socket_path << endl;
+    return -1;
+  }
+  WireHeader header;
+  int status = 0;
+  while(readHeader(fd, header) == 0) {
+    if(header.op == WORKER_SHUTDOWN) break;
+    if(header.params != paramsId(ck->params)) {
+      cout << "Error: worker received samples of another parameter set" << endl;
+      status = -1;
+      break;
+    }
+    // the payload size follows from count and size: beyond the limits the job cannot even be skipped
+    if(header.count > WORKER_MAX_OPERANDS || header.size == 0 || header.size > WORKER_MAX_BITS) {
+      cout << "Error: worker received a job of " << header.count << " values of " << header.size << " bits" << endl;
+      status = -1;
+      break;
+    }
+    LweSample *result = new_gate_bootstrapping_ciphertext_array(header.size, ck->params);
+    status = serveJob(fd, header, result, ck);
+    if(status == 0) status = sendValue(fd, WORKER_RESULT, result, header.size, ck);
+    else if(status == 1) status = writeHeader(fd, WORKER_ERROR, 0, 0);
+    delete_gate_bootstrapping_ciphertext_array(header.size, result);
+    if(status < 0) break;
+  }
+  close(fd);
+  return status;
+}
+
+WorkerPool::WorkerPool(int num_workers, const TFheGateBootstrappingCloudKeySet* ck, string socket_path, bool spawn)
+  : ck(ck), socket_path(socket_path), broken(false) {
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  socket_path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+  unlink(socket_path.c_str());
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listen_fd < 0 || bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(listen_fd, num_workers) < 0) {
+    cout << "Error: failed to listen on " << socket_path << endl;
+    return;
+  }
+  if(spawn) {
+    for(int w = 0; w < num_workers; w++) {
+      pid_t pid = fork();
+      if(pid == 0) {
+        close(listen_fd);
+        _exit(runWorker(socket_path, ck) == 0 ? 0 : 1);
+      }
+      if(pid > 0) pids.push_back(pid);
+    }
+  }
+  // wait for the workers in short polls, so that a forked worker that died is noticed before the timeout
+  const int step_ms = 100;
+  int waited_ms = 0;
+  while((int) fds.size() < num_workers) {
+    struct pollfd pfd = {listen_fd, POLLIN, 0};
+    const int ready = poll(&pfd, 1, step_ms);
+    if(ready < 0) break;
+    if(ready > 0) {
+      int fd = accept(listen_fd, NULL, NULL);
+      if(fd < 0) break;
+      fds.push_back(fd);
+      waited_ms = 0;
+      continue;
+    }
+    waited_ms += step_ms;
+    bool exited = false;
+    for(pid_t& pid: pids) {
+      if(pid > 0 && waitpid(pid, NULL, WNOHANG) == pid) {
+        pid = -1;  // reaped
+        exited = true;
+      }
+    }
+    if(exited || waited_ms >= WORKER_ACCEPT_TIMEOUT_MS) break;
+  }
+  if((int) fds.size() < num_workers) {
+    cout << "Error: only " << fds.size() << " of " << num_workers << " workers connected" << endl;
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  for(int fd: fds) {
+    writeHeader(fd, WORKER_SHUTDOWN, 0, 0);
+    close(fd);
+  }
+  for(pid_t pid: pids) {
+    if(pid > 0) waitpid(pid, NULL, 0);
+  }
+  if(listen_fd >= 0) close(listen_fd);
+  unlink(socket_path.c_str());
+}
+
+int WorkerPool::drain(vector<int>& running, const size_t size) {
+  LweSample *scratch = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+  int status = 0;
+  for(size_t w = 0; w < fds.size(); w++) {
+    if(running[w] < 0) continue;
+    WireHeader header;
+    if(readHeader(fds[w], header) != 0
+       || (header.op == WORKER_RESULT && (header.size != size || readSamples(fds[w], scratch, size, ck->params->in_out_params) < 0))
+       || (header.op != WORKER_RESULT && header.op != WORKER_ERROR)) {
+      status = -1;
+    }
+    running[w] = -1;
+  }
+  delete_gate_bootstrapping_ciphertext_array(size, scratch);
+  return status;
+}
+
+/*
+Each worker holds at most one job. A new job is only sent to a worker after its previous result has been read,
+so neither side can block writing while the other is writing too.
+A failed job leaves the other workers with replies in their sockets, which the next run() would take for its own:
+they are read and discarded first. A connection whose state is unknown (a failed read or write) breaks the pool
+*/
+int WorkerPool::run(vector<WorkerJob>& jobs, const size_t size) {
+  const int workers = fds.size();
+  if(workers == 0 || broken) return -1;
+  vector<int> running(workers, -1);  // job index per worker
+  size_t next = 0, done = 0;
+
+  for(int w = 0; w < workers && next < jobs.size(); w++, next++) {
+    if(sendJob(fds[w], jobs[next], size, ck) < 0) {
+      broken = true;
+      return -1;
+    }
+    running[w] = next;
+  }
+  vector<struct pollfd> pfds(workers);
+  while(done < jobs.size()) {
+    for(int w = 0; w < workers; w++) {
+      pfds[w].fd = running[w] >= 0 ? fds[w] : -1;
+      pfds[w].events = POLLIN;
+      pfds[w].revents = 0;
+    }
+    if(poll(pfds.data(), workers, -1) < 0) {
+      if(drain(running, size) < 0) broken = true;
+      return -1;
+    }
+    for(int w = 0; w < workers; w++) {
+      if(!(pfds[w].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      WireHeader header;
+      WorkerJob &job = jobs[running[w]];
+      running[w] = -1;
+      if(readHeader(fds[w], header) != 0) {
+        broken = true;
+        return -1;
+      }
+      if(header.op != WORKER_RESULT || header.params != paramsId(ck->params) || header.size != size) {
+        // a WORKER_ERROR reply has no payload, the connection is still in step
+        if(header.op != WORKER_ERROR || drain(running, size) < 0) broken = true;
+        return -1;
+      }
+      if(readSamples(fds[w], job.result, size, ck->params->in_out_params) < 0) {
+        broken = true;
+        return -1;
+      }
+      done++;
+      if(next < jobs.size()) {
+        if(sendJob(fds[w], jobs[next], size, ck) < 0) {
+          broken = true;
+          return -1;
+        }
+        running[w] = next++;
+      }
+    }
+  }
+  return 0;
+}
+
+void WorkerPool::reduce_add(LweSample* result, LweSample** arrays, int num_arrays, const size_t size) {
+  const int shards = min((int) fds.size(), num_arrays);
+  if(shards <= 1) {
+    ::reduce_add(result, arrays, num_arrays, ck, size);
+    return;
+  }
+  vector<WorkerJob> jobs(shards);
+  LweSample **partial = new LweSample*[shards];
+  for(int s = 0; s < shards; s++) {
+    partial[s] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+    jobs[s].op = WORKER_REDUCE_ADD;
+    jobs[s].operands.assign(arrays + num_arrays * s / shards, arrays + num_arrays * (s+1) / shards);
+    jobs[s].result = partial[s];
+  }
+  if(run(jobs, size) < 0) {
+    cout << "Error: worker failed, reducing locally." << endl;
+    ::reduce_add(result, arrays, num_arrays, ck, size);
+  }
+  else {
+    ::reduce_add(result, partial, shards, ck, size);
+  }
+  for(int s = 0; s < shards; s++) {
+    delete_gate_bootstrapping_ciphertext_array(size, partial[s]);
+  }
+  delete[] partial;
+}
+
+void WorkerPool::reduce_add_batch(LweSample** results, LweSample** const* arrays, const int* num_arrays, const int count, const size_t size) {
+  vector<WorkerJob> jobs;
+  for(int k = 0; k < count; k++) {
+    if(num_arrays[k] == 0) {
+      zero(results[k], ck, size);
+      continue;
+    }
+    WorkerJob job;
+    job.op = WORKER_REDUCE_ADD;
+    job.operands.assign(arrays[k], arrays[k] + num_arrays[k]);
+    job.result = results[k];
+    jobs.push_back(job);
+  }
+  if(jobs.empty()) return;
+  if(run(jobs, size) < 0) {
+    cout << "Error: worker failed, reducing locally." << endl;
+    ::reduce_add_batch(results, arrays, num_arrays, count, ck, size);
+  }
+}
+
+void WorkerPool::dot(LweSample** results, LweSample** a, LweSample*** X, const int count, const int cols, const size_t size) {
+  if(count < (int) fds.size()) {
+    // few samples: shard each sum instead
+    vector<LweSample*> prod(count * cols);
+    vector<const LweSample*> w(count * cols), x(count * cols);
+    for(int s = 0; s < count; s++) {
+      for(int i = 0; i < cols; i++) {
+        prod[s*cols + i] = new_gate_bootstrapping_ciphertext_array(size, ck->params);
+        w[s*cols + i] = a[i];
+        x[s*cols + i] = X[s][i];
+      }
+    }
+    mult_batch(prod.data(), w.data(), x.data(), count * cols, ck, size);
+    for(int s = 0; s < count; s++) {
+      reduce_add(results[s], &prod[s*cols], cols, size);
+    }
+    for(LweSample *p: prod) delete_gate_bootstrapping_ciphertext_array(size, p);
+    return;
+  }
+  vector<WorkerJob> jobs(count);
+  for(int s = 0; s < count; s++) {
+    jobs[s].op = WORKER_DOT;
+    jobs[s].operands.assign(a, a + cols);
+    jobs[s].operands.insert(jobs[s].operands.end(), X[s], X[s] + cols);
+    jobs[s].result = results[s];
+  }
+  if(run(jobs, size) < 0) {
+    cout << "Error: worker failed, evaluating locally." << endl;
+    for(int s = 0; s < count; s++) {
+      ::dot(results[s], a, X[s], cols, ck, size);
+    }
+  }
+}
+
+void WorkerPool::shiftDot(LweSample** results, LweSample*** a, int* b, const int count, const int cols, const size_t size) {
+  vector<WorkerJob> jobs(count);
+  for(int s = 0; s < count; s++) {
+    jobs[s].op = WORKER_SHIFTDOT;
+    jobs[s].operands.assign(a[s], a[s] + cols);
+    jobs[s].shifts.assign(b, b + cols);
+    jobs[s].result = results[s];
+  }
+  if(run(jobs, size) < 0) {
+    cout << "Error: worker failed, evaluating locally." << endl;
+    TfheBackend be(ck);
+    for(int s = 0; s < count; s++) {
+      circuit::shiftDot(be, results[s], a[s], b, cols, size);
+    }
+  }
+}
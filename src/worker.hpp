@@ -0,0 +1,102 @@
+/**
+    * Local multi-process evaluation.
+    * A coordinator (WorkerPool) shards independent work over N worker processes connected by Unix-domain
+    * sockets and exchanges ciphertexts in the binary wire format of wire.hpp.
+    *
+    * Workers forked by the pool share the coordinator's cloud key copy-on-write: it is never written, so
+    * all processes use the same physical pages. Standalone workers (runWorker from another process) load the
+    * key from a read-only mapping of the key file with loadCloudKeyMapped.
+*/
+
+#pragma once
+
+#include <tfhe/tfhe.h>
+#include <tfhe/tfhe_io.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#define WORKER_ACCEPT_TIMEOUT_MS 30000
+#define WORKER_MAX_OPERANDS (1 << 16)  // values in one job
+#define WORKER_MAX_BITS 64  // width of the values of a job
+
+enum WorkerOp {
+  WORKER_ADD = 1,  // operands: a, b
+  WORKER_SUB,  // operands: a, b
+  WORKER_MULT,  // operands: a, b
+  WORKER_REDUCE_ADD,  // operands: arrays[0..count-1]
+  WORKER_SHIFTDOT,  // count shift exponents (int32), then operands: a[0..count-1]
+  WORKER_RESULT,  // response: one value
+  WORKER_SHUTDOWN,
+  WORKER_ERROR,  // response: the job was rejected, no payload
+  WORKER_DOT  // operands: a[0..n-1], b[0..n-1] (count = 2n), result sum of a[i] * b[i]
+};
+
+struct WorkerJob {
+  WorkerOp op;
+  std::vector<LweSample*> operands;  // each of size bits
+  std::vector<int> shifts;  // WORKER_SHIFTDOT only
+  LweSample* result;  // size bits, filled by WorkerPool::run
+};
+
+TFheGateBootstrappingCloudKeySet* loadCloudKeyMapped(std::string key_path);
+
+// Connects to the coordinator at socket_path and serves jobs until WORKER_SHUTDOWN. Returns 0 on clean shutdown
+int runWorker(std::string socket_path, const TFheGateBootstrappingCloudKeySet* ck);
+
+class WorkerPool {
+  private:
+    const TFheGateBootstrappingCloudKeySet* ck;
+    std::string socket_path;
+    int listen_fd;
+    std::vector<int> fds;  // one connection per worker
+    std::vector<pid_t> pids;  // forked workers
+    bool broken;  // a connection is out of step with its worker, no more jobs are run
+
+    // Reads and discards the reply of every worker with a job in flight (running[w] >= 0)
+    int drain(std::vector<int>& running, const size_t size);
+
+  public:
+
+    /**
+      Listens on socket_path and accepts num_workers workers. If spawn is true the workers are forked
+      from this process, otherwise they are expected to be started separately with runWorker. Gives up after
+      WORKER_ACCEPT_TIMEOUT_MS without a new worker, or as soon as a forked worker exits; size() is then the
+      number of workers that connected.
+      Create the pool before the first OpenMP region: libgomp does not survive fork() in a child of a
+      process whose thread pool is already running
+    */
+    WorkerPool(int num_workers, const TFheGateBootstrappingCloudKeySet* ck, std::string socket_path, bool spawn=true);
+    ~WorkerPool();
+
+    int size() const { return fds.size(); }
+
+    /**
+      Runs all jobs, each on the next idle worker. Returns 0 on success, -1 if a worker failed. After a failure the
+      replies of the other jobs in flight are discarded; if that is not possible the pool is broken and every later
+      run() returns -1
+    */
+    int run(std::vector<WorkerJob>& jobs, const size_t size);
+
+    /**
+      Sum of num_arrays values: one reduce_add subtree per worker, then the partial sums are added here
+    */
+    void reduce_add(LweSample* result, LweSample** arrays, int num_arrays, const size_t size);
+
+    /**
+      results[k] = sum of num_arrays[k] values arrays[k][..], one reduce_add job per sum (empty sums are zero)
+    */
+    void reduce_add_batch(LweSample** results, LweSample** const* arrays, const int* num_arrays, const int count, const size_t size);
+
+    /**
+      results[s] = sum of a[i] * X[s][i] over cols: one WORKER_DOT job per sample, or with fewer samples than workers
+      the products here and each sum sharded with reduce_add
+    */
+    void dot(LweSample** results, LweSample** a, LweSample*** X, const int count, const int cols, const size_t size);
+
+    /**
+      shiftDot of count independent samples a[s][0..cols-1] with the same exponents b, one job per sample
+    */
+    void shiftDot(LweSample** results, LweSample*** a, int* b, const int count, const int cols, const size_t size);
+};
@@ -0,0 +1,20 @@
+/*
+Standalone worker of a WorkerPool (worker.hpp).
+Usage: SHE_worker <cloud key> <socket>
+Start the coordinator first (e.g. SHE_batch --workers <n> --worker-socket <socket>): the worker connects to its socket,
+serves jobs until the coordinator shuts it down and exits 0.
+*/
+#include <iostream>
+#include "worker.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  if(argc < 3) {
+    cout << "Usage: " << argv[0] << " <cloud key> <socket>" << endl;
+    return 1;
+  }
+  const TFheGateBootstrappingCloudKeySet* ck = loadCloudKeyMapped(argv[1]);
+  if(ck == NULL) return 1;
+  return runWorker(argv[2], ck) == 0 ? 0 : 1;
+}